@@ -34,7 +34,12 @@
 template<class T> void ignore_warning(const T&){}
 
 
-std::vector<StagInt> stag::spectral_cluster(stag::Graph *graph, StagInt k) {
+/**
+ * Spectral clustering, for any graph type which can be passed to
+ * stag::compute_eigenvectors.
+ */
+template <typename GraphType>
+std::vector<StagInt> spectral_cluster_inner(GraphType* graph, StagInt k) {
   // Check that the number of clusters is valid.
   if (k < 1 || k > graph->number_of_vertices() /2) {
     throw std::invalid_argument("Number of clusters must be between 1 and n/2.");
@@ -64,7 +69,20 @@ std::vector<StagInt> stag::spectral_cluster(stag::Graph *graph, StagInt k) {
   return {clusters.data(), clusters.data() + clusters.rows()};
 }
 
-std::vector<StagInt> stag::cheeger_cut(stag::Graph* graph) {
+std::vector<StagInt> stag::spectral_cluster(stag::Graph *graph, StagInt k) {
+  return spectral_cluster_inner(graph, k);
+}
+
+std::vector<StagInt> stag::spectral_cluster(stag::UnweightedGraph *graph, StagInt k) {
+  return spectral_cluster_inner(graph, k);
+}
+
+/**
+ * The Cheeger cut, for any graph type which can be passed to
+ * stag::compute_eigensystem and stag::sweep_set_conductance.
+ */
+template <typename GraphType>
+std::vector<StagInt> cheeger_cut_inner(GraphType* graph) {
   // First, compute the first 2 eigenvectors of the normalised graph Laplacian
   // matrix.
   stag::EigenSystem eigsys = stag::compute_eigensystem(
@@ -93,6 +111,14 @@ std::vector<StagInt> stag::cheeger_cut(stag::Graph* graph) {
   return clusters;
 }
 
+std::vector<StagInt> stag::cheeger_cut(stag::Graph* graph) {
+  return cheeger_cut_inner(graph);
+}
+
+std::vector<StagInt> stag::cheeger_cut(stag::UnweightedGraph* graph) {
+  return cheeger_cut_inner(graph);
+}
+
 std::vector<StagInt> stag::local_cluster(stag::LocalGraph *graph, StagInt seed_vertex, double target_volume) {
   if (target_volume <= 0) throw std::invalid_argument("Target volume must be positive.");
 
@@ -180,7 +206,7 @@ void push(stag::LocalGraph *graph, SprsMat *p, SprsMat *r, double alpha, StagInt
   // Iterate through the neighbors of u
   double deg = graph->degree(u);
   StagInt v;
-  for (stag::edge e : graph->neighbors(u)) {
+  for (stag::edge e : graph->neighbors_view(u)) {
     v = e.v2;
     assert(v != u);
 
@@ -232,6 +258,7 @@ std::tuple<SprsMat, SprsMat> stag::approximate_pagerank(stag::LocalGraph *graph,
       stag::sprsMatInnerIndices(&seed_vector));
   std::deque<StagInt> vertex_queue;
   std::unordered_set<StagInt> queue_members;
+  std::vector<StagInt> neighbors;
   StagInt degree_index = 0;
   for (SprsMat::InnerIterator it(seed_vector, 0); it; ++it) {
     u = it.row();
@@ -264,7 +291,13 @@ std::tuple<SprsMat, SprsMat> stag::approximate_pagerank(stag::LocalGraph *graph,
 
     // Check the neighbors of u to see if they should be added back to the queue
     // Skip any neighbors which are already in the queue.
-    std::vector<StagInt> neighbors = graph->neighbors_unweighted(u);
+    // The neighbor ids are copied into a buffer which is reused on every
+    // iteration, since the call to graph->degrees may invalidate the view.
+    // The neighbors are prefetched together, so that a graph on disk can
+    // read them all at once before their degrees are computed.
+    std::span<const StagInt> neighbor_ids = graph->neighbors_view(u).ids();
+    neighbors.assign(neighbor_ids.begin(), neighbor_ids.end());
+    graph->prefetch(neighbors);
     std::vector<double> neighbor_degrees = graph->degrees(neighbors);
 
     // The length of neighbors and neighbor_degrees should always be equal.
@@ -272,10 +305,8 @@ std::tuple<SprsMat, SprsMat> stag::approximate_pagerank(stag::LocalGraph *graph,
     assert(neighbors.size() == neighbor_degrees.size());
 
     degree_index = 0;
-    StagInt v;
-    for (stag::edge e : graph->neighbors(u)) {
-      v = e.v2;
-      if (r.coeff(e.v2, 0) >= epsilon * neighbor_degrees.at(degree_index) &&
+    for (StagInt v : neighbors) {
+      if (r.coeff(v, 0) >= epsilon * neighbor_degrees.at(degree_index) &&
             !queue_members.contains(v)) {
         vertex_queue.push_back(v);
         queue_members.insert(v);
@@ -335,7 +366,7 @@ std::vector<StagInt> sweep_set_conductance_inner(stag::LocalGraph* graph,
     // Update the cut weight. We need to add the total degree of the node v,
     // and then remove any edges from v to the rest of the vertex set.
     cut_weight += degrees.at(current_idx - 1);
-    for (stag::edge e : graph->neighbors(v)) {
+    for (stag::edge e : graph->neighbors_view(v)) {
       if (vertex_set.contains(e.v2)) cut_weight -= 2 * e.weight;
     }
 
@@ -366,6 +397,11 @@ std::vector<StagInt> stag::sweep_set_conductance(stag::Graph* graph,
   return sweep_set_conductance_inner(graph, vec, graph->total_volume());
 }
 
+std::vector<StagInt> stag::sweep_set_conductance(stag::UnweightedGraph* graph,
+                                                 SprsMat& vec) {
+  return sweep_set_conductance_inner(graph, vec, graph->total_volume());
+}
+
 std::vector<StagInt> stag::sweep_set_conductance(stag::LocalGraph* graph,
                                                  SprsMat& vec) {
   return sweep_set_conductance_inner(graph, vec);
@@ -525,9 +561,8 @@ double stag::conductance(stag::LocalGraph* graph, std::vector<StagInt>& cluster)
   double cut = 0;
   double volume = 0;
   for (auto v : cluster) {
-    std::vector<stag::edge> neighbors = graph->neighbors(v);
     double this_deg = 0;
-    for (stag::edge e : neighbors) {
+    for (stag::edge e : graph->neighbors_view(v)) {
       this_deg += e.weight;
 
       // Check whether the neighbor of v is in the set
@@ -584,7 +619,8 @@ std::vector<StagInt> stag::connected_component(stag::LocalGraph* g,
     frontier.pop_back();
 
     // Iterate through the neighbours of this vertex
-    for (auto n : g->neighbors_unweighted(this_vertex)) {
+    auto frontier_size = (StagInt) frontier.size();
+    for (auto n : g->neighbors_view(this_vertex).ids()) {
       // If we have not seen the neighbour before, add it to the connected
       // component, and the frontier of the search.
       if (component_set.find(n) == component_set.end()) {
@@ -593,6 +629,11 @@ std::vector<StagInt> stag::connected_component(stag::LocalGraph* g,
         frontier.push_back(n);
       }
     }
+
+    // Hint that the newly discovered vertices will be visited soon.
+    if ((StagInt) frontier.size() > frontier_size) {
+      g->prefetch(std::span<const StagInt>(frontier).subspan(frontier_size));
+    }
   }
 
   // Return the component that we found
@@ -918,8 +959,8 @@ stag::Graph stag::approximate_similarity_graph(DenseMat* data, StagReal a,
   }
 
   // Return a graph
-  SprsMat adj_mat(data->rows(), data->rows());
-  adj_mat.setFromTriplets(graph_edges.begin(), graph_edges.end());
+  SprsMat adj_mat = stag::sprsMatFromTriplets(graph_edges, data->rows(), data->rows());
+  std::vector<EdgeTriplet>().swap(graph_edges);
   return stag::Graph(adj_mat);
 }
 
@@ -999,7 +1040,7 @@ stag::Graph stag::similarity_graph(DenseMat* data, StagReal a) {
   }
 
   // Return a graph
-  SprsMat adj_mat(n, n);
-  adj_mat.setFromTriplets(graph_edges.begin(), graph_edges.end());
+  SprsMat adj_mat = stag::sprsMatFromTriplets(graph_edges, n, n);
+  std::vector<EdgeTriplet>().swap(graph_edges);
   return stag::Graph(adj_mat);
 }
@@ -71,6 +71,11 @@ namespace stag {
    */
   std::vector<StagInt> spectral_cluster(stag::Graph* graph, StagInt k);
 
+  /**
+   * \overload
+   */
+  std::vector<StagInt> spectral_cluster(stag::UnweightedGraph* graph, StagInt k);
+
   /**
    * Find the Cheeger cut in a graph.
    *
@@ -101,6 +106,11 @@ namespace stag {
    */
   std::vector<StagInt> cheeger_cut(stag::Graph* graph);
 
+  /**
+   * \overload
+   */
+  std::vector<StagInt> cheeger_cut(stag::UnweightedGraph* graph);
+
   /**
    * Local clustering algorithm based on personalised Pagerank.
    *
@@ -201,8 +211,8 @@ namespace stag {
    * the provided vector should be less than half the total volume of the graph.
    * The method does not (and cannot) check this condition.
    *
-   * When the provided graph is a stag::Graph, there is no restriction on the
-   * volume of the support of the provided vector.
+   * When the provided graph is a stag::Graph or stag::UnweightedGraph, there
+   * is no restriction on the volume of the support of the provided vector.
    *
    * Note that the caller is responsible for any required normalisation of the
    * input vector. In particular, this method does not normalise the vector by
@@ -222,6 +232,12 @@ namespace stag {
   std::vector<StagInt> sweep_set_conductance(stag::Graph* graph,
                                              SprsMat& vec);
 
+  /**
+   * @overload
+   */
+  std::vector<StagInt> sweep_set_conductance(stag::UnweightedGraph* graph,
+                                             SprsMat& vec);
+
   /**
    * Return the vertex indices of every vertex in the same connected
    * component as the specified vertex.
@@ -0,0 +1,312 @@
+/*
+   This file is provided as part of the STAG library and released under the GPL
+   license.
+*/
+
+/**
+ * @file compactgraph.h
+ * \brief A memory-efficient graph representation with configurable data types.
+ *
+ * The stag::Graph class stores its adjacency matrix with 64-bit indices and
+ * double precision weights. For large graphs, this can use more memory than
+ * necessary. The stag::CompactGraph class stores a graph with smaller index
+ * and weight types, for example 32-bit unsigned indices and single precision
+ * weights, which halves the memory required for each edge.
+ */
+
+#ifndef STAG_LIBRARY_COMPACTGRAPH_H
+#define STAG_LIBRARY_COMPACTGRAPH_H
+
+#include <vector>
+#include <span>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#include "definitions.h"
+#include "graph.h"
+
+namespace stag {
+
+  /**
+   * \brief A graph stored in compressed sparse format with configurable index
+   * and weight types.
+   *
+   * The graph is stored as a single compressed sparse array of neighbors,
+   * using the IndexType for the neighbor ids and the WeightType for the edge
+   * weights. The offsets into the neighbor array always use 64-bit integers,
+   * so that graphs with more than \f$2^{32}\f$ edges can be stored with 32-bit
+   * vertex indices.
+   *
+   * A CompactGraph implements the stag::LocalGraph interface, and so it can be
+   * passed to any of the local algorithms in the library, such as
+   * stag::local_cluster.
+   *
+   * \code{.cpp}
+   *     #include <stag/graph.h>
+   *     #include <stag/compactgraph.h>
+   *     #include <stag/cluster.h>
+   *
+   *     int main() {
+   *       stag::Graph myGraph = stag::barbell_graph(10);
+   *
+   *       // Convert the graph to use 32-bit indices and float weights.
+   *       stag::CompactGraph<uint32_t, float> compactGraph(myGraph);
+   *
+   *       std::vector<StagInt> cluster = stag::local_cluster(&compactGraph, 0, 50);
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   *
+   * @tparam IndexType an unsigned integer type used to store vertex indices
+   * @tparam WeightType a floating point type used to store edge weights
+   */
+  template <typename IndexType = uint32_t, typename WeightType = float>
+  class CompactGraph : public LocalGraph {
+    static_assert(std::is_integral_v<IndexType>,
+                  "CompactGraph index type must be an integer type.");
+    static_assert(std::is_floating_point_v<WeightType>,
+                  "CompactGraph weight type must be a floating point type.");
+
+    public:
+      /**
+       * Construct a compact copy of the given graph.
+       *
+       * Edge weights are converted to the WeightType, and so may lose
+       * precision.
+       *
+       * @param graph the graph to copy
+       * @throws std::invalid_argument if the vertex indices of the graph
+       *         cannot be represented by the IndexType
+       */
+      explicit CompactGraph(const Graph& graph);
+
+      /**
+       * Construct a stag::Graph object with the same edges as this graph.
+       *
+       * @return a new stag::Graph object
+       */
+      Graph to_graph() const;
+
+      /**
+       * The number of vertices in the graph.
+       */
+      StagInt number_of_vertices() const;
+
+      /**
+       * The number of edges in the graph.
+       */
+      StagInt number_of_edges() const;
+
+      /**
+       * Return the ids of the neighbors of v, using the IndexType of this graph.
+       *
+       * The returned span refers to the memory of this graph, and so no
+       * data is copied.
+       */
+      std::span<const IndexType> neighbor_ids(StagInt v) const;
+
+      /**
+       * Return the weights of the edges from v to each of its neighbors, in
+       * the same order as stag::CompactGraph::neighbor_ids.
+       */
+      std::span<const WeightType> neighbor_weights(StagInt v) const;
+
+      /**
+       * The number of bytes used to store the edges and degrees of the graph.
+       */
+      StagUInt memory_usage() const;
+
+      // Override the abstract methods in the LocalGraph base class.
+      StagReal degree(StagInt v) override;
+      StagInt degree_unweighted(StagInt v) override;
+      std::vector<edge> neighbors(StagInt v) override;
+      std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+      NeighborView neighbors_view(StagInt v) override;
+      std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
+      std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
+      bool vertex_exists(StagInt v) override;
+      ~CompactGraph() override = default;
+
+    private:
+      /**
+       * Check the validity of a method argument which is supposed to refer
+       * to a vertex in the graph.
+       *
+       * @throws std::invalid_argument if the check does not pass
+       */
+      void check_vertex_argument(StagInt v) const;
+
+      // The number of vertices and edges in the graph.
+      StagInt number_of_vertices_;
+      StagInt number_of_edges_;
+
+      // The compressed sparse representation of the adjacency matrix. The
+      // neighbors of vertex v are stored in positions offsets_[v] to
+      // offsets_[v + 1] - 1 of the neighbors_ and weights_ vectors.
+      std::vector<StagUInt> offsets_;
+      std::vector<IndexType> neighbors_;
+      std::vector<WeightType> weights_;
+
+      // The weighted degree of every vertex. These are stored at full
+      // precision to avoid accumulating errors when summing many
+      // low-precision weights.
+      std::vector<StagReal> degrees_;
+  };
+
+  /**
+   * \cond
+   * Do not document the implementation of the template class.
+   */
+  template <typename IndexType, typename WeightType>
+  CompactGraph<IndexType, WeightType>::CompactGraph(const Graph& graph) {
+    const SprsMat* adj = graph.adjacency();
+    number_of_vertices_ = graph.number_of_vertices();
+    number_of_edges_ = graph.number_of_edges();
+
+    if (number_of_vertices_ > 0 &&
+        (StagUInt) (number_of_vertices_ - 1) > (StagUInt) std::numeric_limits<IndexType>::max()) {
+      throw std::invalid_argument("Number of vertices is too large for the index type.");
+    }
+
+    // Copy the compressed sparse arrays of the adjacency matrix, converting
+    // them to the compact types. The tombstones of edges removed from a
+    // dynamic graph are skipped.
+    const StagInt *colStarts = adj->outerIndexPtr();
+    const StagInt *rowIndices = adj->innerIndexPtr();
+    const StagReal *values = adj->valuePtr();
+    StagInt nnz = adj->nonZeros();
+    offsets_.reserve(number_of_vertices_ + 1);
+    neighbors_.reserve(nnz);
+    weights_.reserve(nnz);
+    offsets_.push_back(0);
+    for (StagInt v = 0; v < number_of_vertices_; v++) {
+      for (StagInt k = colStarts[v]; k < colStarts[v + 1]; k++) {
+        if (values[k] == 0) continue;
+        neighbors_.push_back((IndexType) rowIndices[k]);
+        weights_.push_back((WeightType) values[k]);
+      }
+      offsets_.push_back(neighbors_.size());
+    }
+
+    // The weighted degrees are taken from the original graph at full
+    // precision.
+    degrees_ = *graph.degree_vector();
+  }
+
+  template <typename IndexType, typename WeightType>
+  Graph CompactGraph<IndexType, WeightType>::to_graph() const {
+    std::vector<StagInt> outerStarts(offsets_.begin(), offsets_.end());
+    std::vector<StagInt> innerIndices(neighbors_.begin(), neighbors_.end());
+    std::vector<StagReal> values(weights_.begin(), weights_.end());
+    return {outerStarts, innerIndices, values};
+  }
+
+  template <typename IndexType, typename WeightType>
+  StagInt CompactGraph<IndexType, WeightType>::number_of_vertices() const {
+    return number_of_vertices_;
+  }
+
+  template <typename IndexType, typename WeightType>
+  StagInt CompactGraph<IndexType, WeightType>::number_of_edges() const {
+    return number_of_edges_;
+  }
+
+  template <typename IndexType, typename WeightType>
+  std::span<const IndexType> CompactGraph<IndexType, WeightType>::neighbor_ids(StagInt v) const {
+    check_vertex_argument(v);
+    return {neighbors_.data() + offsets_[v], offsets_[v + 1] - offsets_[v]};
+  }
+
+  template <typename IndexType, typename WeightType>
+  std::span<const WeightType> CompactGraph<IndexType, WeightType>::neighbor_weights(StagInt v) const {
+    check_vertex_argument(v);
+    return {weights_.data() + offsets_[v], offsets_[v + 1] - offsets_[v]};
+  }
+
+  template <typename IndexType, typename WeightType>
+  StagUInt CompactGraph<IndexType, WeightType>::memory_usage() const {
+    return offsets_.size() * sizeof(StagUInt) +
+           neighbors_.size() * sizeof(IndexType) +
+           weights_.size() * sizeof(WeightType) +
+           degrees_.size() * sizeof(StagReal);
+  }
+
+  template <typename IndexType, typename WeightType>
+  StagReal CompactGraph<IndexType, WeightType>::degree(StagInt v) {
+    check_vertex_argument(v);
+    return degrees_[v];
+  }
+
+  template <typename IndexType, typename WeightType>
+  StagInt CompactGraph<IndexType, WeightType>::degree_unweighted(StagInt v) {
+    // A self-loop contributes 1 to the unweighted degree, in addition to its
+    // entry in the neighbor array. The neighbors of each vertex are sorted.
+    std::span<const IndexType> ids = neighbor_ids(v);
+    StagInt self_loop = std::binary_search(ids.begin(), ids.end(), (IndexType) v) ? 1 : 0;
+    return (StagInt) ids.size() + self_loop;
+  }
+
+  template <typename IndexType, typename WeightType>
+  std::vector<edge> CompactGraph<IndexType, WeightType>::neighbors(StagInt v) {
+    NeighborView view = neighbors_view(v);
+    return {view.begin(), view.end()};
+  }
+
+  template <typename IndexType, typename WeightType>
+  std::vector<StagInt> CompactGraph<IndexType, WeightType>::neighbors_unweighted(StagInt v) {
+    std::span<const IndexType> ids = neighbor_ids(v);
+    return {ids.begin(), ids.end()};
+  }
+
+  template <typename IndexType, typename WeightType>
+  NeighborView CompactGraph<IndexType, WeightType>::neighbors_view(StagInt v) {
+    // The neighbors are stored with different types to the ones used by
+    // the view, and so they are converted into the buffers owned by the
+    // LocalGraph base class. The buffers are reused between calls.
+    std::span<const IndexType> ids = neighbor_ids(v);
+    std::span<const WeightType> weights = neighbor_weights(v);
+    view_ids_buffer_.assign(ids.begin(), ids.end());
+    view_weights_buffer_.assign(weights.begin(), weights.end());
+    return {v, view_ids_buffer_.data(), view_weights_buffer_.data(),
+            (StagInt) view_ids_buffer_.size()};
+  }
+
+  template <typename IndexType, typename WeightType>
+  std::vector<StagReal> CompactGraph<IndexType, WeightType>::degrees(std::vector<StagInt> vertices) {
+    std::vector<StagReal> degs;
+    degs.reserve(vertices.size());
+    for (StagInt v : vertices) degs.push_back(degree(v));
+    return degs;
+  }
+
+  template <typename IndexType, typename WeightType>
+  std::vector<StagInt> CompactGraph<IndexType, WeightType>::degrees_unweighted(std::vector<StagInt> vertices) {
+    std::vector<StagInt> degs;
+    degs.reserve(vertices.size());
+    for (StagInt v : vertices) degs.push_back(degree_unweighted(v));
+    return degs;
+  }
+
+  template <typename IndexType, typename WeightType>
+  bool CompactGraph<IndexType, WeightType>::vertex_exists(StagInt v) {
+    return v >= 0 && v < number_of_vertices_;
+  }
+
+  template <typename IndexType, typename WeightType>
+  void CompactGraph<IndexType, WeightType>::check_vertex_argument(StagInt v) const {
+    if (v >= number_of_vertices_) {
+      throw std::invalid_argument("Specified vertex index too large.");
+    }
+    if (v < 0) {
+      throw std::invalid_argument("Vertex indices cannot be negative.");
+    }
+  }
+  /**
+   * \endcond
+   */
+}
+
+#endif //STAG_LIBRARY_COMPACTGRAPH_H
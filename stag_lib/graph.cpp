@@ -5,14 +5,69 @@
 #include <stdexcept>
 #include <fstream>
 #include <unordered_map>
-#include <unordered_set>
 #include <set>
+#include <algorithm>
+#include <numeric>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "graph.h"
 #include "utility.h"
 #include "graphio.h"
 #include "cluster.h"
 
 
+/**
+ * A clock used to record the order in which the derived matrices of every
+ * graph are used.
+ */
+static std::atomic<StagUInt> cache_clock = 0;
+
+/**
+ * The number of bytes allocated to store a sparse matrix.
+ */
+StagUInt sprs_mat_memory_usage(const SprsMat& matrix) {
+  StagUInt bytes = matrix.data().allocatedSize() * (sizeof(StagReal) + sizeof(StagInt));
+  bytes += (matrix.outerSize() + 1) * sizeof(StagInt);
+  if (!matrix.isCompressed()) bytes += matrix.outerSize() * sizeof(StagInt);
+  return bytes;
+}
+
+//------------------------------------------------------------------------------
+// Local Graph Default Methods
+//------------------------------------------------------------------------------
+stag::NeighborView stag::LocalGraph::neighbors_view(StagInt v) {
+  // By default, copy the neighbors into the buffers owned by this object.
+  // Reusing the buffers avoids allocating new memory on every call.
+  view_ids_buffer_.clear();
+  view_weights_buffer_.clear();
+  for (stag::edge e : neighbors(v)) {
+    view_ids_buffer_.push_back(e.v2);
+    view_weights_buffer_.push_back(e.weight);
+  }
+
+  return {v, view_ids_buffer_.data(), view_weights_buffer_.data(),
+          (StagInt) view_ids_buffer_.size()};
+}
+
+void stag::LocalGraph::prefetch(std::span<const StagInt> /* vertices */) {
+  // By default, the hint is ignored.
+}
+
 //------------------------------------------------------------------------------
 // Graph Object Constructors
 //------------------------------------------------------------------------------
@@ -91,23 +146,11 @@ stag::Graph::Graph(const SprsMat& matrix) {
   // The number of vertices is the dimensions of the adjacency matrix
   number_of_vertices_ = adjacency_matrix_.outerSize();
 
-  // Check whether the graph has any self-loops
-  has_self_loops_ = false;
-  for (auto i = 0; i < number_of_vertices_; i++) {
-    if (adjacency_matrix_.coeff(i, i) != 0) {
-      has_self_loops_ = true;
-      break;
-    }
-  }
+  // Compute the vertex degrees, and check whether the graph has any self-loops
+  update_degrees_();
 
   // Set the flags to indicate which matrices have been initialised.
-  lap_init_ = false;
-  signless_lap_init_ = false;
-  signless_norm_lap_init_ = false;
-  deg_init_ = false;
-  inv_deg_init_ = false;
-  norm_lap_init_ = false;
-  lazy_rand_walk_init_ = false;
+  reset_initialised_flags_();
 
   // Check that the graph is configured correctly
   self_test_();
@@ -122,23 +165,11 @@ stag::Graph::Graph(std::vector<StagInt> &outerStarts, std::vector<StagInt> &inne
   // The number of vertices is the dimensions of the adjacency matrix
   number_of_vertices_ = adjacency_matrix_.outerSize();
 
-  // Check whether the graph has any self-loops
-  has_self_loops_ = false;
-  for (auto i = 0; i < number_of_vertices_; i++) {
-    if (adjacency_matrix_.coeff(i, i) != 0) {
-      has_self_loops_ = true;
-      break;
-    }
-  }
+  // Compute the vertex degrees, and check whether the graph has any self-loops
+  update_degrees_();
 
   // Set the flags to indicate which matrices have been initialised.
-  lap_init_ = false;
-  signless_lap_init_ = false;
-  signless_norm_lap_init_ = false;
-  deg_init_ = false;
-  inv_deg_init_ = false;
-  norm_lap_init_ = false;
-  lazy_rand_walk_init_ = false;
+  reset_initialised_flags_();
 
   // Check that the graph is configured correctly
   self_test_();
@@ -152,56 +183,44 @@ const SprsMat* stag::Graph::adjacency() const {
   return &adjacency_matrix_;
 }
 
-const SprsMat* stag::Graph::laplacian() {
-  initialise_laplacian_();
-  return &laplacian_matrix_;
+const SprsMat* stag::Graph::laplacian() const {
+  return cached_matrix_(laplacian_matrix_, &stag::Graph::initialise_laplacian_);
 }
 
-const SprsMat* stag::Graph::normalised_laplacian() {
-  initialise_normalised_laplacian_();
-  return &normalised_laplacian_matrix_;
+const SprsMat* stag::Graph::normalised_laplacian() const {
+  return cached_matrix_(normalised_laplacian_matrix_, &stag::Graph::initialise_normalised_laplacian_);
 }
 
-const SprsMat* stag::Graph::signless_laplacian() {
-  initialise_signless_laplacian_();
-  return &signless_laplacian_matrix_;
+const SprsMat* stag::Graph::signless_laplacian() const {
+  return cached_matrix_(signless_laplacian_matrix_, &stag::Graph::initialise_signless_laplacian_);
 }
 
-const SprsMat* stag::Graph::normalised_signless_laplacian() {
-  initialise_normalised_signless_laplacian_();
-  return &normalised_signless_laplacian_matrix_;
+const SprsMat* stag::Graph::normalised_signless_laplacian() const {
+  return cached_matrix_(normalised_signless_laplacian_matrix_, &stag::Graph::initialise_normalised_signless_laplacian_);
 }
 
-const SprsMat* stag::Graph::degree_matrix() {
-  initialise_degree_matrix_();
-  return &degree_matrix_;
+const SprsMat* stag::Graph::degree_matrix() const {
+  return cached_matrix_(degree_matrix_, &stag::Graph::initialise_degree_matrix_);
 }
 
-const SprsMat* stag::Graph::inverse_degree_matrix() {
-  initialise_inverse_degree_matrix_();
-  return &inverse_degree_matrix_;
+const SprsMat* stag::Graph::inverse_degree_matrix() const {
+  return cached_matrix_(inverse_degree_matrix_, &stag::Graph::initialise_inverse_degree_matrix_);
 }
 
-const SprsMat* stag::Graph::lazy_random_walk_matrix() {
-  initialise_lazy_random_walk_matrix_();
-  return &lazy_random_walk_matrix_;
+const SprsMat* stag::Graph::lazy_random_walk_matrix() const {
+  return cached_matrix_(lazy_random_walk_matrix_, &stag::Graph::initialise_lazy_random_walk_matrix_);
 }
 
-StagReal stag::Graph::total_volume() {
-  // We will compute the total volume from the degree matrix of the graph.
-  initialise_degree_matrix_();
-
-  StagReal vol = 0;
-  for (int k = 0; k < degree_matrix_.outerSize() ; ++k) {
-    for (SprsMat::InnerIterator it(degree_matrix_, k); it; ++it) {
-      vol += it.value();
-    }
-  }
+const std::vector<StagReal>* stag::Graph::degree_vector() const {
+  return &degrees_;
+}
 
-  return vol;
+StagReal stag::Graph::total_volume() const {
+  // The total volume is updated whenever the graph is modified.
+  return total_volume_;
 }
 
-StagReal stag::Graph::average_degree() {
+StagReal stag::Graph::average_degree() const {
   return total_volume() / number_of_vertices_;
 }
 
@@ -210,75 +229,157 @@ StagInt stag::Graph::number_of_vertices() const {
 }
 
 StagInt stag::Graph::number_of_edges() const {
-  StagInt nnz = adjacency_matrix_.nonZeros();
-
-  if (has_self_loops_) {
-    // If there are self loops in the graph, then we need to count the non-zeros
-    // on the diagonal twice.
-    for (auto i = 0; i < number_of_vertices_; i++) {
-      if (adjacency_matrix_.coeff(i, i) != 0) nnz++;
-    }
-
-    // Now, we have counted every edge twice.
-    return nnz / 2;
-  } else {
-    // If there are no self loops in the graph, then the number of edges is
-    // half the number of non-zero elements in the adjacency matrix.
-    return nnz / 2;
-  }
+  // The number of edges is updated whenever the graph is modified.
+  return number_of_edges_;
 }
 
 void stag::Graph::add_edge(StagInt i, StagInt j, StagReal w) {
+  // In dynamic mode, an edge which is already stored in the adjacency matrix
+  // is updated without rebuilding the matrix or recomputing the degrees.
+  // As below, the weight of a self-loop is added to its entry twice.
+  StagReal entry_weight = i == j ? 2 * w : w;
+  if (dynamic_ && i >= 0 && j >= 0 &&
+      update_edge_in_place_(i, j, entry_weight, true)) {
+    reset_initialised_flags_();
+    return;
+  }
+
   number_of_vertices_ = MAX(number_of_vertices_, MAX(i, j) + 1);
   adjacency_matrix_.conservativeResize(number_of_vertices_, number_of_vertices_);
   adjacency_matrix_.coeffRef(i, j) += w;
   adjacency_matrix_.coeffRef(j, i) += w;
   adjacency_matrix_.makeCompressed();
 
-  if (i == j) {
-    has_self_loops_ = true;
-  }
-
-  // Set the flags to indicate which matrices have been initialised.
-  lap_init_ = false;
-  signless_lap_init_ = false;
-  signless_norm_lap_init_ = false;
-  deg_init_ = false;
-  inv_deg_init_ = false;
-  norm_lap_init_ = false;
-  lazy_rand_walk_init_ = false;
+  // Update the vertex degrees and set the flags to indicate which matrices
+  // have been initialised.
+  update_degrees_();
+  reset_initialised_flags_();
+  if (dynamic_) compact_if_needed_();
 }
 
 void stag::Graph::remove_edge(StagInt i, StagInt j) {
   if (i >= number_of_vertices_ || j >= number_of_vertices_) return;
 
+  // In dynamic mode, the removed edge is left in the adjacency matrix as a
+  // tombstone.
+  if (dynamic_) {
+    if (i < 0 || j < 0) return;
+    update_edge_in_place_(i, j, 0, false);
+    reset_initialised_flags_();
+    compact_if_needed_();
+    return;
+  }
+
   adjacency_matrix_.coeffRef(i, j) = 0;
   adjacency_matrix_.coeffRef(j, i) = 0;
   adjacency_matrix_.prune(0.0);
   adjacency_matrix_.makeCompressed();
 
-  if (i == j) {
-    assert(has_self_loops_);
+  // Update the vertex degrees and set the flags to indicate which matrices
+  // have been initialised. Updating the degrees also checks whether there are
+  // any self-loops remaining in the graph.
+  update_degrees_();
+  reset_initialised_flags_();
+}
 
-    // If we removed a self-loop, we need to check whether there is still
-    // a self loop.
-    has_self_loops_ = false;
-    for (auto i = 0; i < number_of_vertices_; i++) {
-      if (adjacency_matrix_.coeff(i, i) != 0) {
-        has_self_loops_ = true;
-        break;
-      }
+void stag::Graph::add_edges(const std::vector<edge>& edges) {
+  if (edges.empty()) return;
+
+  // Check every edge before modifying the graph, so that the graph is left
+  // unchanged if any edge is invalid.
+  StagInt new_number_of_vertices = number_of_vertices_;
+  for (const stag::edge& e : edges) {
+    if (e.v1 < 0 || e.v2 < 0) {
+      throw std::invalid_argument("Vertex indices cannot be negative.");
     }
+    new_number_of_vertices = MAX(new_number_of_vertices, MAX(e.v1, e.v2) + 1);
   }
 
-  // Set the flags to indicate which matrices have been initialised.
-  lap_init_ = false;
-  signless_lap_init_ = false;
-  signless_norm_lap_init_ = false;
-  deg_init_ = false;
-  inv_deg_init_ = false;
-  norm_lap_init_ = false;
-  lazy_rand_walk_init_ = false;
+  // Construct a sparse matrix containing the new edges in both directions.
+  std::vector<EdgeTriplet> non_zero_entries;
+  non_zero_entries.reserve(2 * edges.size());
+  for (const stag::edge& e : edges) {
+    non_zero_entries.emplace_back(e.v1, e.v2, e.weight);
+    non_zero_entries.emplace_back(e.v2, e.v1, e.weight);
+  }
+  SprsMat new_edges = stag::sprsMatFromTriplets(
+      non_zero_entries, new_number_of_vertices, new_number_of_vertices);
+  number_of_vertices_ = new_number_of_vertices;
+
+  // Adding two sparse matrices takes time linear in the number of non-zeros,
+  // and so the adjacency matrix is only updated once.
+  adjacency_matrix_.conservativeResize(number_of_vertices_, number_of_vertices_);
+  adjacency_matrix_ += new_edges;
+  adjacency_matrix_.makeCompressed();
+
+  // Update the vertex degrees and set the flags to indicate which matrices
+  // have been initialised.
+  update_degrees_();
+  reset_initialised_flags_();
+  if (dynamic_) compact_if_needed_();
+}
+
+void stag::Graph::remove_edges(const std::vector<edge>& edges) {
+  if (edges.empty()) return;
+
+  // In dynamic mode, the removed edges are left in the adjacency matrix as
+  // tombstones, and the matrix is compacted at most once.
+  if (dynamic_) {
+    for (const stag::edge& e : edges) {
+      if (e.v1 < 0 || e.v2 < 0) continue;
+      if (e.v1 >= number_of_vertices_ || e.v2 >= number_of_vertices_) continue;
+      update_edge_in_place_(e.v1, e.v2, 0, false);
+    }
+    reset_initialised_flags_();
+    compact_if_needed_();
+    return;
+  }
+
+  // Set the weight of every removed edge to zero, and then prune the zero
+  // entries from the adjacency matrix all at once.
+  StagReal *weights = adjacency_matrix_.valuePtr();
+  auto zero_entry = [&](StagInt row, StagInt col) {
+    StagInt entry = find_entry_(row, col);
+    if (entry >= 0) weights[entry] = 0;
+  };
+
+  for (const stag::edge& e : edges) {
+    if (e.v1 < 0 || e.v2 < 0) continue;
+    if (e.v1 >= number_of_vertices_ || e.v2 >= number_of_vertices_) continue;
+    zero_entry(e.v1, e.v2);
+    zero_entry(e.v2, e.v1);
+  }
+  adjacency_matrix_.prune(0.0);
+  adjacency_matrix_.makeCompressed();
+
+  // Update the vertex degrees and set the flags to indicate which matrices
+  // have been initialised.
+  update_degrees_();
+  reset_initialised_flags_();
+}
+
+void stag::Graph::set_dynamic(bool dynamic) {
+  dynamic_ = dynamic;
+  if (!dynamic_) compact();
+}
+
+bool stag::Graph::is_dynamic() const {
+  return dynamic_;
+}
+
+void stag::Graph::compact() {
+  if (number_of_tombstones_ == 0) return;
+
+  // The values in the matrix are unchanged, and so the derived matrices do
+  // not need to be computed again. Recomputing the degrees removes any
+  // floating-point error accumulated by updating them edge-by-edge.
+  adjacency_matrix_.prune(0.0);
+  adjacency_matrix_.makeCompressed();
+  update_degrees_();
+}
+
+StagInt stag::Graph::number_of_tombstones() const {
+  return number_of_tombstones_;
 }
 
 bool stag::Graph::has_self_loops() const {
@@ -303,12 +404,41 @@ void stag::Graph::check_vertex_argument(StagInt v) const {
   }
 }
 
+stag::GraphMemoryUsage stag::Graph::memory_usage() const {
+  return {
+    sprs_mat_memory_usage(adjacency_matrix_),
+    degrees_.capacity() * sizeof(StagReal) +
+        unweighted_degrees_.capacity() * sizeof(StagInt),
+    laplacian_matrix_.memory_usage(),
+    signless_laplacian_matrix_.memory_usage(),
+    normalised_laplacian_matrix_.memory_usage(),
+    normalised_signless_laplacian_matrix_.memory_usage(),
+    degree_matrix_.memory_usage(),
+    inverse_degree_matrix_.memory_usage(),
+    lazy_random_walk_matrix_.memory_usage()
+  };
+}
+
+void stag::Graph::set_cache_budget(StagUInt bytes) {
+  cache_budget_ = bytes;
+  enforce_cache_budget_(nullptr);
+}
+
+StagUInt stag::Graph::cache_budget() const {
+  return cache_budget_;
+}
+
+void stag::Graph::clear_cache() {
+  reset_initialised_flags_();
+}
+
 //------------------------------------------------------------------------------
 // Local Graph Methods
 //------------------------------------------------------------------------------
 
 std::vector<StagReal> stag::Graph::degrees(std::vector<StagInt> vertices) {
     std::vector<StagReal> degrees;
+    degrees.reserve(vertices.size());
 
     for (StagInt v : vertices) {
         degrees.emplace_back(degree(v));
@@ -320,6 +450,7 @@ std::vector<StagReal> stag::Graph::degrees(std::vector<StagInt> vertices) {
 std::vector<StagInt> stag::Graph::degrees_unweighted(
         std::vector<StagInt> vertices) {
     std::vector<StagInt> degrees;
+    degrees.reserve(vertices.size());
 
     for (StagInt v : vertices) {
         degrees.emplace_back(degree_unweighted(v));
@@ -332,10 +463,9 @@ std::vector<StagInt> stag::Graph::degrees_unweighted(
 StagReal stag::Graph::degree(StagInt v) {
   check_vertex_argument(v);
 
-  // For now, we can be a little lazy and use the degree matrix. Once this is
-  // initialised, then checking degree is constant time.
-  initialise_degree_matrix_();
-  return degree_matrix_.coeff(v, v);
+  // The degrees are computed whenever the graph is modified, and so checking
+  // the degree is constant time.
+  return degrees_[v];
 }
 
 StagInt stag::Graph::degree_unweighted(StagInt v) {
@@ -343,34 +473,22 @@ StagInt stag::Graph::degree_unweighted(StagInt v) {
 
   // The combinatorical degree of a vertex is equal to the number of non-zero
   // entries in its adjacency matrix row, plus 1 if there is a self-loop.
-  const StagInt *indexPtr = adjacency_matrix_.outerIndexPtr();
-  StagInt rowStart = *(indexPtr + v);
-  StagInt nextRowStart = *(indexPtr + v + 1);
-  StagInt self_loop = 0;
-  if (adjacency_matrix_.coeff(v, v) != 0) self_loop = 1;
-
-  return nextRowStart - rowStart + self_loop;
+  return unweighted_degrees_[v];
 }
 
 std::vector<stag::edge> stag::Graph::neighbors(StagInt v) {
   check_vertex_argument(v);
 
-  // Iterate through the non-zero entries in the vth row of the adjacency matrix
+  // Iterate through the non-zero entries in the vth row of the adjacency
+  // matrix, skipping the tombstones of any removed edges.
   const StagReal *weights = adjacency_matrix_.valuePtr();
   const StagInt *innerIndices = adjacency_matrix_.innerIndexPtr();
   const StagInt *rowStarts = adjacency_matrix_.outerIndexPtr();
-  StagInt vRowStart = *(rowStarts + v);
-  StagInt degree_unw = degree_unweighted(v);
-
-  // If there is a self-loop, then we have to subtract one from the unweighted
-  // degree.
-  StagInt self_loop = 0;
-  if (adjacency_matrix_.coeff(v, v) != 0) self_loop = 1;
 
   std::vector<stag::edge> edges;
-  for (StagInt i = 0; i < degree_unw - self_loop; i++) {
-    if (*(weights + vRowStart + i) != 0) {
-      edges.push_back({v, *(innerIndices + vRowStart + i), *(weights + vRowStart + i)});
+  for (StagInt k = rowStarts[v]; k < rowStarts[v + 1]; k++) {
+    if (weights[k] != 0) {
+      edges.push_back({v, innerIndices[k], weights[k]});
     }
   }
 
@@ -383,15 +501,48 @@ std::vector<StagInt> stag::Graph::neighbors_unweighted(StagInt v) {
   // Return the non-zero indices in the vth row of the adjacency matrix
   const StagInt *innerIndices = adjacency_matrix_.innerIndexPtr();
   const StagInt *rowStarts = adjacency_matrix_.outerIndexPtr();
-  StagInt vRowStart = *(rowStarts + v);
-  StagInt degree = degree_unweighted(v);
+  if (number_of_tombstones_ == 0) {
+    return {innerIndices + rowStarts[v], innerIndices + rowStarts[v + 1]};
+  }
 
-  // If there is a self-loop, then we have to subtract one from the unweighted
-  // degree.
-  StagInt self_loop = 0;
-  if (adjacency_matrix_.coeff(v, v) != 0) self_loop = 1;
+  const StagReal *weights = adjacency_matrix_.valuePtr();
+  std::vector<StagInt> neighbors;
+  for (StagInt k = rowStarts[v]; k < rowStarts[v + 1]; k++) {
+    if (weights[k] != 0) neighbors.push_back(innerIndices[k]);
+  }
+  return neighbors;
+}
+
+stag::NeighborView stag::Graph::neighbors_view(StagInt v) {
+  check_vertex_argument(v);
+
+  // The neighbors of v are given directly by the non-zero entries in the vth
+  // column of the adjacency matrix.
+  const StagInt *rowStarts = adjacency_matrix_.outerIndexPtr();
+  StagInt vRowStart = *(rowStarts + v);
+  StagInt vRowEnd = *(rowStarts + v + 1);
+
+  // If some edges have been removed in dynamic mode, copy the remaining
+  // neighbors into the buffers owned by the LocalGraph base class.
+  if (number_of_tombstones_ > 0) {
+    const StagInt *innerIndices = adjacency_matrix_.innerIndexPtr();
+    const StagReal *weights = adjacency_matrix_.valuePtr();
+    view_ids_buffer_.clear();
+    view_weights_buffer_.clear();
+    for (StagInt k = vRowStart; k < vRowEnd; k++) {
+      if (weights[k] != 0) {
+        view_ids_buffer_.push_back(innerIndices[k]);
+        view_weights_buffer_.push_back(weights[k]);
+      }
+    }
+    return {v, view_ids_buffer_.data(), view_weights_buffer_.data(),
+            (StagInt) view_ids_buffer_.size()};
+  }
 
-  return {innerIndices + vRowStart, innerIndices + vRowStart + degree - self_loop};
+  return {v,
+          adjacency_matrix_.innerIndexPtr() + vRowStart,
+          adjacency_matrix_.valuePtr() + vRowStart,
+          vRowEnd - vRowStart};
 }
 
 bool stag::Graph::vertex_exists(StagInt v) {
@@ -399,41 +550,9 @@ bool stag::Graph::vertex_exists(StagInt v) {
 }
 
 stag::Graph stag::Graph::subgraph(std::vector<StagInt>& vertices) {
-  // Convert the vector of vertices to a set, and construct the map from old
-  // vertex ID to the new one.
-  std::unordered_set<StagInt> vertex_set;
-  std::unordered_map<StagInt, StagInt> old_to_new_id;
-  StagInt next_id = 0;
-  for (StagInt v : vertices) {
-    if (!vertex_set.contains(v)) {
-      vertex_set.insert(v);
-      old_to_new_id.insert({v, next_id});
-      next_id++;
-    }
-  }
-
-  // Construct the non-zero entries in the new adjacency matrix
-  std::vector<EdgeTriplet> non_zero_entries;
-  for (StagInt v : vertex_set) {
-    for (stag::edge e : neighbors(v)) {
-      if (e.v2 >= v && vertex_set.contains(e.v2)) {
-        non_zero_entries.emplace_back(
-            old_to_new_id[v], old_to_new_id[e.v2], e.weight);
-
-        // Add the symmetric entry to the adjacency matrix only if this is
-        // not a self-loop.
-        if (e.v2 > v) {
-          non_zero_entries.emplace_back(
-              old_to_new_id[e.v2], old_to_new_id[v], e.weight);
-        }
-      }
-    }
-  }
-
-  // Construct the final adjacency matrix
-  SprsMat adj_mat((StagInt) vertex_set.size(), (StagInt) vertex_set.size());
-  adj_mat.setFromTriplets(non_zero_entries.begin(), non_zero_entries.end());
-  return stag::Graph(adj_mat);
+  // The subgraph view filters the neighbors of each vertex without any
+  // hashing, and labels the vertices in the order in which they are given.
+  return stag::SubgraphView(this, vertices).materialise();
 }
 
 stag::Graph stag::Graph::disjoint_union(Graph& other) {
@@ -472,351 +591,1736 @@ stag::Graph stag::Graph::disjoint_union(Graph& other) {
 // Graph Object Private Methods
 //------------------------------------------------------------------------------
 
-void stag::Graph::self_test_() {
-  // Check that the adjacency matrix is symmetric.
-  if (!stag::isSymmetric(&adjacency_matrix_)) {
-    throw std::domain_error("Graph adjacency matrix must be symmetric.");
+void stag::Graph::reset_initialised_flags_() {
+  laplacian_matrix_.reset();
+  signless_laplacian_matrix_.reset();
+  normalised_laplacian_matrix_.reset();
+  normalised_signless_laplacian_matrix_.reset();
+  degree_matrix_.reset();
+  inverse_degree_matrix_.reset();
+  lazy_random_walk_matrix_.reset();
+}
+
+const SprsMat* stag::Graph::cached_matrix_(const LazySprsMat& matrix,
+                                          MatrixInitialiser initialise) const {
+  bool computed = false;
+  const SprsMat* result = matrix.get([&](SprsMat& m) {
+    (this->*initialise)(m);
+    computed = true;
+  });
+  matrix.mark_used(++cache_clock);
+
+  // Other matrices are only discarded when a new matrix is computed, since
+  // this is the only time the memory used can increase.
+  if (computed && cache_budget_ < std::numeric_limits<StagUInt>::max()) {
+    enforce_cache_budget_(&matrix);
+  }
+  return result;
+}
+
+void stag::Graph::enforce_cache_budget_(const LazySprsMat* keep) const {
+  std::vector<const LazySprsMat*> matrices = {
+      &laplacian_matrix_, &signless_laplacian_matrix_,
+      &normalised_laplacian_matrix_, &normalised_signless_laplacian_matrix_,
+      &degree_matrix_, &inverse_degree_matrix_, &lazy_random_walk_matrix_};
+
+  StagUInt total_memory = 0;
+  for (const LazySprsMat* matrix : matrices) total_memory += matrix->memory_usage();
+  if (total_memory <= cache_budget_) return;
+
+  // Discard the least recently used matrices first.
+  std::sort(matrices.begin(), matrices.end(),
+            [](const LazySprsMat* a, const LazySprsMat* b) {
+              return a->last_used() < b->last_used();
+            });
+  for (const LazySprsMat* matrix : matrices) {
+    if (total_memory <= cache_budget_) break;
+    if (matrix == keep || !matrix->initialised()) continue;
+    total_memory -= matrix->memory_usage();
+    matrix->evict();
   }
 }
 
-void stag::Graph::initialise_laplacian_() {
-  // If the laplacian matrix has already been initialised, then we do not
-  // initialise it again.
-  if (lap_init_) return;
+void stag::Graph::update_degrees_() {
+  degrees_.assign(number_of_vertices_, 0);
+  unweighted_degrees_.assign(number_of_vertices_, 0);
+  total_volume_ = 0;
+  number_of_self_loops_ = 0;
+  number_of_tombstones_ = 0;
 
-  // Ensure that the degree matrix is initialised
-  initialise_degree_matrix_();
+  // Make a single pass over the columns of the adjacency matrix.
+  // A self-loop contributes twice to the degree of its vertex, and zero
+  // entries are tombstones which do not count as edges.
+  const StagInt *rowStarts = adjacency_matrix_.outerIndexPtr();
+  const StagInt *innerIndices = adjacency_matrix_.innerIndexPtr();
+  const StagReal *weights = adjacency_matrix_.valuePtr();
+  for (StagInt v = 0; v < number_of_vertices_; v++) {
+    StagReal deg = 0;
+    StagReal self_loop_weight = 0;
+    for (StagInt k = rowStarts[v]; k < rowStarts[v + 1]; k++) {
+      if (weights[k] == 0) {
+        number_of_tombstones_++;
+        continue;
+      }
+      deg += weights[k];
+      unweighted_degrees_[v]++;
+      if (innerIndices[k] == v) self_loop_weight = weights[k];
+    }
+    degrees_[v] = deg + self_loop_weight;
+    if (self_loop_weight != 0) {
+      unweighted_degrees_[v]++;
+      number_of_self_loops_++;
+    }
+    total_volume_ += degrees_[v];
+  }
 
-  // Construct and return the laplacian matrix.
-  laplacian_matrix_ = degree_matrix_ - adjacency_matrix_;
-  laplacian_matrix_.makeCompressed();
+  // Every edge other than a self-loop appears twice in the adjacency matrix.
+  has_self_loops_ = number_of_self_loops_ > 0;
+  number_of_edges_ = (adjacency_matrix_.nonZeros() - number_of_tombstones_
+      + number_of_self_loops_) / 2;
+}
 
-  // We have now initialised the laplacian.
-  lap_init_ = true;
+StagInt stag::Graph::find_entry_(StagInt row, StagInt col) const {
+  // The columns of the compressed adjacency matrix are sorted, so we can
+  // find each entry with a binary search.
+  const StagInt *rowStarts = adjacency_matrix_.outerIndexPtr();
+  const StagInt *innerIndices = adjacency_matrix_.innerIndexPtr();
+  const StagInt *col_start = innerIndices + rowStarts[col];
+  const StagInt *col_end = innerIndices + rowStarts[col + 1];
+  const StagInt *entry = std::lower_bound(col_start, col_end, row);
+  if (entry != col_end && *entry == row) return entry - innerIndices;
+  return -1;
 }
 
-void stag::Graph::initialise_signless_laplacian_() {
-  // If the signless laplacian matrix has already been initialised, then we do not
-  // initialise it again.
-  if (signless_lap_init_) return;
+bool stag::Graph::update_edge_in_place_(StagInt i, StagInt j, StagReal w,
+                                        bool accumulate) {
+  if (i >= number_of_vertices_ || j >= number_of_vertices_) return false;
+  StagInt entry_ij = find_entry_(i, j);
+  StagInt entry_ji = find_entry_(j, i);
+  if (entry_ij < 0 || entry_ji < 0) return false;
+
+  StagReal *weights = adjacency_matrix_.valuePtr();
+  StagReal old_weight = weights[entry_ij];
+  StagReal new_weight = accumulate ? old_weight + w : w;
+  weights[entry_ij] = new_weight;
+  weights[entry_ji] = new_weight;
+
+  // A self-loop contributes twice to the degree of its vertex.
+  StagReal weight_change = new_weight - old_weight;
+  degrees_[i] += weight_change;
+  degrees_[j] += weight_change;
+  total_volume_ += 2 * weight_change;
+
+  // Update the counts if the edge is removed, or a removed edge is added
+  // back to the graph.
+  bool was_edge = old_weight != 0;
+  bool is_edge = new_weight != 0;
+  if (was_edge != is_edge) {
+    StagInt change = is_edge ? 1 : -1;
+    unweighted_degrees_[i] += change;
+    unweighted_degrees_[j] += change;
+    number_of_edges_ += change;
+    if (i == j) {
+      number_of_tombstones_ -= change;
+      number_of_self_loops_ += change;
+      has_self_loops_ = number_of_self_loops_ > 0;
+    } else {
+      number_of_tombstones_ -= 2 * change;
+    }
+  }
 
-  // Ensure that the degree matrix is initialised
-  initialise_degree_matrix_();
+  // Avoid leaving floating-point errors in the degree of an isolated vertex.
+  if (unweighted_degrees_[i] == 0) degrees_[i] = 0;
+  if (unweighted_degrees_[j] == 0) degrees_[j] = 0;
+  if (number_of_edges_ == 0) total_volume_ = 0;
+  return true;
+}
 
-  // Construct and return the signless Laplacian matrix.
-  signless_laplacian_matrix_ = degree_matrix_ + adjacency_matrix_;
-  signless_laplacian_matrix_.makeCompressed();
+void stag::Graph::compact_if_needed_() {
+  if (2 * number_of_tombstones_ >= adjacency_matrix_.nonZeros() &&
+      number_of_tombstones_ > 0) {
+    compact();
+  }
+}
 
-  // We have now initialised the signless laplacian.
-  signless_lap_init_ = true;
+void stag::Graph::self_test_() {
+  // Check that the adjacency matrix is symmetric.
+  if (!stag::isSymmetric(&adjacency_matrix_)) {
+    throw std::domain_error("Graph adjacency matrix must be symmetric.");
+  }
 }
 
-void stag::Graph::initialise_normalised_laplacian_() {
-  // If the normalised laplacian matrix has already been initialised, then we
-  // do not initialise it again.
-  if (norm_lap_init_) return;
+void stag::Graph::initialise_laplacian_(SprsMat& laplacian) const {
+  // Construct the laplacian matrix.
+  laplacian = *degree_matrix() - adjacency_matrix_;
+  laplacian.makeCompressed();
+}
 
-  // Ensure that the degree matrix is initialised
-  initialise_degree_matrix_();
+void stag::Graph::initialise_signless_laplacian_(SprsMat& signless_laplacian) const {
+  // Construct the signless Laplacian matrix.
+  signless_laplacian = *degree_matrix() + adjacency_matrix_;
+  signless_laplacian.makeCompressed();
+}
 
+void stag::Graph::initialise_normalised_laplacian_(SprsMat& normalised_laplacian) const {
   // Construct the inverse degree matrix
   SprsMat sqrt_inv_deg_mat(number_of_vertices_, number_of_vertices_);
   std::vector<EdgeTriplet> non_zero_entries;
   for (StagInt i = 0; i < number_of_vertices_; i++) {
-    non_zero_entries.emplace_back(i, i, 1 / sqrt(degree_matrix_.coeff(i, i)));
+    non_zero_entries.emplace_back(i, i, 1 / sqrt(degrees_[i]));
   }
   sqrt_inv_deg_mat.setFromTriplets(non_zero_entries.begin(), non_zero_entries.end());
 
   // The normalised laplacian is defined by I - D^{-1/2} A D^{-1/2}
   SprsMat identity_matrix(number_of_vertices_, number_of_vertices_);
   identity_matrix.setIdentity();
-  normalised_laplacian_matrix_ = identity_matrix - sqrt_inv_deg_mat * adjacency_matrix_ * sqrt_inv_deg_mat;
-  normalised_laplacian_matrix_.makeCompressed();
-
-  // We have now initialised the normalised laplacian matrix.
-  norm_lap_init_ = true;
+  normalised_laplacian = identity_matrix - sqrt_inv_deg_mat * adjacency_matrix_ * sqrt_inv_deg_mat;
+  normalised_laplacian.makeCompressed();
 }
 
-void stag::Graph::initialise_normalised_signless_laplacian_() {
-  // If the normalised signless laplacian matrix has already been initialised, then we
-  // do not initialise it again.
-  if (signless_norm_lap_init_) return;
-
-  // Ensure that the degree matrix is initialised
-  initialise_degree_matrix_();
-
+void stag::Graph::initialise_normalised_signless_laplacian_(SprsMat& normalised_signless_laplacian) const {
   // Construct the inverse degree matrix
   SprsMat sqrt_inv_deg_mat(number_of_vertices_, number_of_vertices_);
   std::vector<EdgeTriplet> non_zero_entries;
   for (StagInt i = 0; i < number_of_vertices_; i++) {
-    non_zero_entries.emplace_back(i, i, 1 / sqrt(degree_matrix_.coeff(i, i)));
+    non_zero_entries.emplace_back(i, i, 1 / sqrt(degrees_[i]));
   }
   sqrt_inv_deg_mat.setFromTriplets(non_zero_entries.begin(), non_zero_entries.end());
 
   // The normalised signless laplacian is defined by I + D^{-1/2} A D^{-1/2}
   SprsMat identity_matrix(number_of_vertices_, number_of_vertices_);
   identity_matrix.setIdentity();
-  normalised_signless_laplacian_matrix_ = identity_matrix + sqrt_inv_deg_mat * adjacency_matrix_ * sqrt_inv_deg_mat;
-  normalised_signless_laplacian_matrix_.makeCompressed();
-
-  // We have now initialised the normalised laplacian matrix.
-  signless_norm_lap_init_ = true;
+  normalised_signless_laplacian = identity_matrix + sqrt_inv_deg_mat * adjacency_matrix_ * sqrt_inv_deg_mat;
+  normalised_signless_laplacian.makeCompressed();
 }
 
-void stag::Graph::initialise_degree_matrix_() {
-  // If the degree matrix has already been initialised, then we do not
-  // initialise it again.
-  if (deg_init_) return;
-
-  // Construct the vertex degrees.
-  Eigen::VectorXd simple_degrees = adjacency_matrix_ * Eigen::VectorXd::Ones(adjacency_matrix_.cols());
-  degree_matrix_ = SprsMat(adjacency_matrix_.cols(), adjacency_matrix_.cols());
-  for (StagInt i = 0; i < adjacency_matrix_.cols(); i++) {
-    // If there is a self-loop on this vertex, then we count its weight twice
-    // for the vertex degree.
-    degree_matrix_.insert(i, i) = simple_degrees[i] + adjacency_matrix_.coeff(i, i);
+void stag::Graph::initialise_degree_matrix_(SprsMat& degree_matrix) const {
+  // Construct the degree matrix from the vertex degrees.
+  degree_matrix = SprsMat(number_of_vertices_, number_of_vertices_);
+  degree_matrix.reserve(Eigen::VectorXi::Constant(number_of_vertices_, 1));
+  for (StagInt i = 0; i < number_of_vertices_; i++) {
+    degree_matrix.insert(i, i) = degrees_[i];
   }
 
-  // Compress the degree matrix storage, and set the initialised flag
-  degree_matrix_.makeCompressed();
-  deg_init_ = true;
+  // Compress the degree matrix storage
+  degree_matrix.makeCompressed();
 }
 
-void stag::Graph::initialise_inverse_degree_matrix_() {
-  // If the inverse degree matrix has already been initialised, then we do not
-  // initialise it again.
-  if (inv_deg_init_) return;
-
-  // We will construct the inverse degree matrix from the degree matrix itself
-  initialise_degree_matrix_();
-  inverse_degree_matrix_ = SprsMat(adjacency_matrix_.cols(), adjacency_matrix_.cols());
-  for (StagInt i = 0; i < adjacency_matrix_.cols(); i++) {
-    inverse_degree_matrix_.insert(i, i) = 1./degree_matrix_.coeff(i, i);
+void stag::Graph::initialise_inverse_degree_matrix_(SprsMat& inverse_degree_matrix) const {
+  // We will construct the inverse degree matrix from the vertex degrees
+  inverse_degree_matrix = SprsMat(number_of_vertices_, number_of_vertices_);
+  inverse_degree_matrix.reserve(Eigen::VectorXi::Constant(number_of_vertices_, 1));
+  for (StagInt i = 0; i < number_of_vertices_; i++) {
+    inverse_degree_matrix.insert(i, i) = 1./degrees_[i];
   }
 
-  // Compress the degree matrix storage, and set the initialised flag
-  inverse_degree_matrix_.makeCompressed();
-  inv_deg_init_ = true;
+  // Compress the degree matrix storage
+  inverse_degree_matrix.makeCompressed();
 }
 
-void stag::Graph::initialise_lazy_random_walk_matrix_() {
-  // If the lazy random walk matrix has already been initialised, then we do not
-  // initialise it again.
-  if (lazy_rand_walk_init_) return;
-
+void stag::Graph::initialise_lazy_random_walk_matrix_(SprsMat& lazy_random_walk_matrix) const {
   // The lazy random walk matrix is defined to be
   //   (1/2) I + (1/2) A * D^{-1}
-  initialise_inverse_degree_matrix_();
   SprsMat identityMatrix(number_of_vertices_, number_of_vertices_);
   identityMatrix.setIdentity();
 
-  lazy_random_walk_matrix_ = SprsMat(number_of_vertices_, number_of_vertices_);
-  lazy_random_walk_matrix_ = (1./2) * identityMatrix + (1./2) * adjacency_matrix_ * inverse_degree_matrix_;
+  lazy_random_walk_matrix = (1./2) * identityMatrix + (1./2) * adjacency_matrix_ * (*inverse_degree_matrix());
 
-  // Compress and set initialisation flag
-  lazy_random_walk_matrix_.makeCompressed();
-  lazy_rand_walk_init_ = true;
+  // Compress the matrix storage
+  lazy_random_walk_matrix.makeCompressed();
 }
 
 //------------------------------------------------------------------------------
-// Equality Operators
+// Lazily Computed Matrices
 //------------------------------------------------------------------------------
-bool stag::operator==(const stag::Graph& lhs, const stag::Graph& rhs) {
-  bool outerIndicesEqual = stag::sprsMatOuterStarts(lhs.adjacency()) == stag::sprsMatOuterStarts(rhs.adjacency());
-  bool innerIndicesEqual = stag::sprsMatInnerIndices(lhs.adjacency()) == stag::sprsMatInnerIndices(rhs.adjacency());
-  bool valuesEqual = stag::sprsMatValues(lhs.adjacency()) == stag::sprsMatValues(rhs.adjacency());
-  return (outerIndicesEqual && innerIndicesEqual) && valuesEqual;
+stag::LazySprsMat::LazySprsMat(const LazySprsMat& other) {
+  *this = other;
 }
 
-bool stag::operator!=(const stag::Graph &lhs, const stag::Graph &rhs) {
-  return !(lhs == rhs);
+stag::LazySprsMat::LazySprsMat(LazySprsMat&& other) noexcept {
+  *this = std::move(other);
 }
 
-bool stag::operator==(const stag::edge &lhs, const stag::edge &rhs) {
-  return lhs.v1 == rhs.v1 && lhs.v2 == rhs.v2 && lhs.weight == rhs.weight;
+stag::LazySprsMat& stag::LazySprsMat::operator=(const LazySprsMat& other) {
+  if (this == &other) return *this;
+
+  // Lock the other matrix in case it is being computed by another thread.
+  std::lock_guard<std::mutex> lock(other.mutex_);
+  if (other.initialised_.load(std::memory_order_relaxed)) {
+    matrix_ = other.matrix_;
+    initialised_.store(true, std::memory_order_release);
+  } else {
+    reset();
+  }
+  last_used_.store(other.last_used(), std::memory_order_relaxed);
+  return *this;
 }
 
-bool stag::operator!=(const stag::edge &lhs, const stag::edge &rhs) {
-  return !(lhs == rhs);
+stag::LazySprsMat& stag::LazySprsMat::operator=(LazySprsMat&& other) noexcept {
+  if (this == &other) return *this;
+
+  matrix_ = std::move(other.matrix_);
+  initialised_.store(other.initialised_.load(std::memory_order_relaxed),
+                     std::memory_order_release);
+  last_used_.store(other.last_used(), std::memory_order_relaxed);
+  other.reset();
+  return *this;
+}
+
+void stag::LazySprsMat::reset() {
+  matrix_ = SprsMat();
+  initialised_.store(false, std::memory_order_release);
+}
+
+bool stag::LazySprsMat::initialised() const {
+  return initialised_.load(std::memory_order_acquire);
+}
+
+void stag::LazySprsMat::evict() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  matrix_ = SprsMat();
+  initialised_.store(false, std::memory_order_release);
+}
+
+void stag::LazySprsMat::mark_used(StagUInt time) const {
+  last_used_.store(time, std::memory_order_relaxed);
+}
+
+StagUInt stag::LazySprsMat::last_used() const {
+  return last_used_.load(std::memory_order_relaxed);
+}
+
+StagUInt stag::LazySprsMat::memory_usage() const {
+  // A matrix which is being computed holds its lock, and does not count
+  // towards the memory used until it is finished.
+  if (!initialised()) return 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  return sprs_mat_memory_usage(matrix_);
 }
 
 //------------------------------------------------------------------------------
-// Adjacency List Local Graph
+// Graph Memory Usage
 //------------------------------------------------------------------------------
-StagInt stag::AdjacencyListLocalGraph::goto_next_content_line() {
-  std::string current_line;
+StagUInt stag::GraphMemoryUsage::cached() const {
+  return laplacian + signless_laplacian + normalised_laplacian +
+         normalised_signless_laplacian + degree_matrix + inverse_degree_matrix +
+         lazy_random_walk_matrix;
+}
 
-  // Read the current line, discarding it. This leaves the file pointer at the
-  // beginning of a line.
-  std::streampos current_loc = is_.tellg();
-  if (current_loc != 0) stag::safeGetline(is_, current_line);
+StagUInt stag::GraphMemoryUsage::total() const {
+  return adjacency + degrees + cached();
+}
 
-  current_loc = is_.tellg();
-  while (true) {
-    // If the current position is the end of the file, we have failed to find
-    // a content line. Return -1.
-    if (current_loc == end_of_file_) {
-      return -1;
+//------------------------------------------------------------------------------
+// Memory Mapped Files
+//------------------------------------------------------------------------------
+stag::MappedFile::MappedFile(const std::string& filename) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Couldn't open file " + filename);
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    throw std::runtime_error("Couldn't read the size of file " + filename);
+  }
+  size_ = (StagUInt) file_size.QuadPart;
+
+  // An empty file cannot be mapped, and has no data to read.
+  if (size_ > 0) {
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0,
+                                        nullptr);
+    if (mapping != nullptr) {
+      data_ = (const char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
     }
+  }
+  CloseHandle(file);
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Couldn't open file " + filename);
+  }
+  struct stat file_stats;
+  if (fstat(fd, &file_stats) != 0) {
+    close(fd);
+    throw std::runtime_error("Couldn't read the size of file " + filename);
+  }
+  size_ = (StagUInt) file_stats.st_size;
 
-    // Read until we find a non-empty line.
-    // Make sure to set current_loc to the position just before calling getline.
-    current_line.clear();
-    while (current_line.empty()) {
-      current_loc = is_.tellg();
-      stag::safeGetline(is_, current_line);
-    }
+  // An empty file cannot be mapped, and has no data to read.
+  if (size_ > 0) {
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping != MAP_FAILED) data_ = (const char*) mapping;
+  }
 
-    // Check if this line is a valid content line.
-    size_t split_pos = current_line.find(':');
-    if (split_pos != std::string::npos) {
-      std::string token = current_line.substr(0, split_pos);
-      StagInt source_node_id = std::stoi(token);
+  // The mapping remains valid after the file is closed.
+  close(fd);
+#endif
 
-      // We found a content line, reset the position of the reader to the start
-      // of the line and return the node id.
-      is_.seekg(current_loc);
-      return source_node_id;
-    }
+  if (size_ > 0 && data_ == nullptr) {
+    throw std::runtime_error("Couldn't map file " + filename + " into memory");
   }
+}
 
-  // If we couldn't find a content line, then the adjacencylist is badly formed.
-  throw std::runtime_error("Malformed adjacencylist file.");
+stag::MappedFile::MappedFile(MappedFile&& other) noexcept {
+  *this = std::move(other);
 }
 
-stag::AdjacencyListLocalGraph::AdjacencyListLocalGraph(const std::string &filename) {
-  // Open the file handle to the graph on disk, and get the maximum length of the
-  // file.
-  is_ = std::ifstream(filename);
+stag::MappedFile& stag::MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this == &other) return *this;
 
-  // If the file could not be opened, throw an exception
-  if (!is_.is_open()) {
-    throw std::runtime_error(std::strerror(errno));
-  }
+  unmap_();
+  data_ = other.data_;
+  size_ = other.size_;
+  other.data_ = nullptr;
+  other.size_ = 0;
+  return *this;
+}
+
+stag::MappedFile::~MappedFile() {
+  unmap_();
+}
 
-  // Get the length of the file in bytes.
-  is_.seekg(0, std::ios::end);
-  end_of_file_ = is_.tellg();
+const char* stag::MappedFile::data() const {
+  return data_;
 }
 
-void stag::AdjacencyListLocalGraph::find_vertex(StagInt v) {
-  // Set the maximum and minimum ranges of the file to search
-  std::streampos range_min = 0;
-  std::streampos range_max = end_of_file_;
+StagUInt stag::MappedFile::size() const {
+  return size_;
+}
 
-  // Perform a binary search for the target node
-  StagInt current_id;
-  bool found_target = false;
-  while (!found_target) {
-    // If min is greater than max, then we have failed to find our target point
-    if (range_min > range_max) throw std::runtime_error("Couldn't find node in adjacencylist file.");
+void stag::MappedFile::prefetch(StagUInt offset, StagUInt length) const {
+  if (offset >= size_ || length == 0) return;
+  length = std::min(length, size_ - offset);
+#ifndef _WIN32
+  // The advice must begin at a page boundary. The kernel begins reading the
+  // pages in the background, and the call returns immediately.
+  static const StagUInt page_size = sysconf(_SC_PAGESIZE);
+  StagUInt start = offset - offset % page_size;
+  madvise((void*) (data_ + start), offset + length - start, MADV_WILLNEED);
+#endif
+}
 
-    // Search half-way between the search points.
-    StagInt search_point = floor((range_max + range_min) / 2);
+void stag::MappedFile::unmap_() {
+  if (data_ != nullptr) {
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap((void*) data_, size_);
+#endif
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
 
-    // Check whether this point has been searched before
-    if (fileloc_to_node_id_.find(search_point) != fileloc_to_node_id_.end()) {
-      // We have searched this point before
-      current_id = fileloc_to_node_id_[search_point];
+//------------------------------------------------------------------------------
+// Graph Builder
+//------------------------------------------------------------------------------
+stag::GraphBuilder::GraphBuilder() : GraphBuilder(0) {}
 
-      // If this is the point we're looking for, make sure that the file pointer
-      // is pointing to the right place.
-      if (current_id == v) {
-        is_.seekg((std::streampos) search_point);
-        goto_next_content_line();
-      }
-    } else {
-      // We have never searched this point before - we need to check the
-      // file on disk.
-      is_.seekg((std::streampos) search_point);
-      current_id = goto_next_content_line();
-      fileloc_to_node_id_[search_point] = current_id;
-    }
+stag::GraphBuilder::GraphBuilder(StagInt number_of_vertices) {
+  if (number_of_vertices < 0) {
+    throw std::invalid_argument("Number of vertices cannot be negative.");
+  }
+  number_of_vertices_ = number_of_vertices;
+}
 
-    if (current_id == v) {
-      found_target = true;
-    } else if (current_id == -1 || current_id > v) {
-      range_max = search_point - std::streamoff(1);
-    } else {
-      range_min = search_point + std::streamoff(1);
-    }
+void stag::GraphBuilder::add_edge(StagInt i, StagInt j, StagReal w) {
+  if (i < 0 || j < 0) {
+    throw std::invalid_argument("Vertex indices cannot be negative.");
   }
+  number_of_vertices_ = MAX(number_of_vertices_, MAX(i, j) + 1);
+
+  // Add the edge in both directions in order to keep the adjacency matrix
+  // symmetric.
+  non_zero_entries_.emplace_back(i, j, w);
+  non_zero_entries_.emplace_back(j, i, w);
 }
 
-std::vector<stag::edge> stag::AdjacencyListLocalGraph::neighbors(StagInt v) {
-  // If we have searched for this vertex before, just returned the cached copy.
-  if (node_id_to_edgelist_.find(v) != node_id_to_edgelist_.end()) {
-    return node_id_to_edgelist_[v];
+void stag::GraphBuilder::add_edges(const std::vector<edge>& edges) {
+  reserve((StagInt) (non_zero_entries_.size() / 2 + edges.size()));
+  for (const stag::edge& e : edges) {
+    add_edge(e.v1, e.v2, e.weight);
   }
+}
 
-  // First, find the target vertex in the adjacencylist file.
-  find_vertex(v);
+void stag::GraphBuilder::reserve(StagInt number_of_edges) {
+  non_zero_entries_.reserve(2 * number_of_edges);
+}
 
-  // We are pointing at the correct content line. Parse it to get the neighbours.
-  std::string content_line;
-  stag::safeGetline(is_, content_line);
-  std::vector<stag::edge> neighbors;
-  std::vector<stag::edge> edges = stag::parse_adjacencylist_content_line(
-      content_line);
+StagInt stag::GraphBuilder::number_of_vertices() const {
+  return number_of_vertices_;
+}
 
-  // Update our internal edgelist.
-  node_id_to_edgelist_[v] = edges;
+void stag::GraphBuilder::clear() {
+  non_zero_entries_.clear();
+  non_zero_entries_.shrink_to_fit();
+}
 
-  return edges;
+stag::Graph stag::GraphBuilder::build() const {
+  // Duplicate entries are summed when constructing the matrix from triplets.
+  SprsMat adj_mat = stag::sprsMatFromTriplets(
+      non_zero_entries_, number_of_vertices_, number_of_vertices_);
+  return stag::Graph(adj_mat);
 }
 
-std::vector<StagInt> stag::AdjacencyListLocalGraph::neighbors_unweighted(StagInt v) {
-  auto edges = neighbors(v);
-  std::vector<StagInt> unweighted_neighbors;
-  for (stag::edge e : edges) {
-    unweighted_neighbors.push_back(e.v2);
+//------------------------------------------------------------------------------
+// Unweighted Graph
+//------------------------------------------------------------------------------
+stag::UnweightedGraph::UnweightedGraph(const stag::Graph& graph) {
+  const SprsMat* adj = graph.adjacency();
+  const StagInt *colStarts = adj->outerIndexPtr();
+  const StagInt *rowIndices = adj->innerIndexPtr();
+  const StagReal *values = adj->valuePtr();
+  number_of_vertices_ = graph.number_of_vertices();
+
+  // Copy the structure of the adjacency matrix, skipping any explicitly
+  // stored zero entries.
+  number_of_self_loops_ = 0;
+  StagInt max_neighbors = 0;
+  outer_starts_.reserve(number_of_vertices_ + 1);
+  inner_indices_.reserve(adj->nonZeros());
+  outer_starts_.push_back(0);
+  for (StagInt v = 0; v < number_of_vertices_; v++) {
+    for (StagInt k = colStarts[v]; k < colStarts[v + 1]; k++) {
+      if (values[k] == 0) continue;
+      inner_indices_.push_back(rowIndices[k]);
+      if (rowIndices[k] == v) number_of_self_loops_++;
+    }
+    outer_starts_.push_back((StagInt) inner_indices_.size());
+    max_neighbors = MAX(max_neighbors, outer_starts_[v + 1] - outer_starts_[v]);
   }
-  return unweighted_neighbors;
+
+  number_of_edges_ = ((StagInt) inner_indices_.size() + number_of_self_loops_) / 2;
+  unit_weights_.assign(max_neighbors, 1);
 }
 
-StagReal stag::AdjacencyListLocalGraph::degree(StagInt v) {
-  auto edges = neighbors(v);
-  StagReal deg = 0;
-  for (stag::edge e : edges) {
-    // Self-loops count twice towards the degree
-    if (e.v2 == v) deg += 2 * e.weight;
-    else deg += e.weight;
-  }
-  return deg;
+stag::Graph stag::UnweightedGraph::to_graph() const {
+  std::vector<StagInt> outerStarts = outer_starts_;
+  std::vector<StagInt> innerIndices = inner_indices_;
+  std::vector<StagReal> values(inner_indices_.size(), 1);
+  return {outerStarts, innerIndices, values};
 }
 
-StagInt stag::AdjacencyListLocalGraph::degree_unweighted(StagInt v) {
-  auto edges = neighbors(v);
-  return edges.size();
+StagInt stag::UnweightedGraph::number_of_vertices() const {
+  return number_of_vertices_;
 }
 
-std::vector<StagReal> stag::AdjacencyListLocalGraph::degrees(std::vector<StagInt> vertices) {
-  std::vector<StagReal> degs;
-  for (auto v : vertices) {
-    degs.push_back(degree(v));
-  }
-  return degs;
+StagInt stag::UnweightedGraph::number_of_edges() const {
+  return number_of_edges_;
 }
 
-std::vector<StagInt> stag::AdjacencyListLocalGraph::degrees_unweighted(std::vector<StagInt> vertices) {
-  std::vector<StagInt> degs;
-  for (auto v : vertices) {
-    degs.push_back(degree_unweighted(v));
-  }
-  return degs;
+StagReal stag::UnweightedGraph::total_volume() const {
+  return (StagReal) (2 * number_of_edges_);
 }
 
-bool stag::AdjacencyListLocalGraph::vertex_exists(StagInt v) {
-  try {
-    find_vertex(v);
-    return true;
-  } catch (std::runtime_error& e) {
-    return false;
-  }
+bool stag::UnweightedGraph::has_self_loops() const {
+  return number_of_self_loops_ > 0;
+}
+
+const std::vector<StagInt>* stag::UnweightedGraph::outer_starts() const {
+  return &outer_starts_;
+}
+
+const std::vector<StagInt>* stag::UnweightedGraph::inner_indices() const {
+  return &inner_indices_;
+}
+
+StagUInt stag::UnweightedGraph::memory_usage() const {
+  return (outer_starts_.size() + inner_indices_.size()) * sizeof(StagInt) +
+         unit_weights_.size() * sizeof(StagReal);
+}
+
+StagReal stag::UnweightedGraph::degree(StagInt v) {
+  // Every edge has weight 1, and so the weighted degree is equal to the
+  // unweighted degree.
+  return (StagReal) degree_unweighted(v);
 }
 
-stag::AdjacencyListLocalGraph::~AdjacencyListLocalGraph() {
-  is_.close();
+StagInt stag::UnweightedGraph::degree_unweighted(StagInt v) {
+  check_vertex_argument(v);
+
+  // A self-loop contributes 1 to the degree, in addition to its entry in the
+  // neighbor array. The neighbors of each vertex are sorted.
+  auto start = inner_indices_.begin() + outer_starts_[v];
+  auto end = inner_indices_.begin() + outer_starts_[v + 1];
+  StagInt self_loop = std::binary_search(start, end, v) ? 1 : 0;
+  return outer_starts_[v + 1] - outer_starts_[v] + self_loop;
+}
+
+std::vector<stag::edge> stag::UnweightedGraph::neighbors(StagInt v) {
+  stag::NeighborView view = neighbors_view(v);
+  return {view.begin(), view.end()};
+}
+
+std::vector<StagInt> stag::UnweightedGraph::neighbors_unweighted(StagInt v) {
+  check_vertex_argument(v);
+  return {inner_indices_.begin() + outer_starts_[v],
+          inner_indices_.begin() + outer_starts_[v + 1]};
+}
+
+stag::NeighborView stag::UnweightedGraph::neighbors_view(StagInt v) {
+  check_vertex_argument(v);
+
+  // The weights of every view refer to the same vector of ones, and so no
+  // data is copied.
+  StagInt start = outer_starts_[v];
+  return {v, inner_indices_.data() + start, unit_weights_.data(),
+          outer_starts_[v + 1] - start};
+}
+
+std::vector<StagReal> stag::UnweightedGraph::degrees(std::vector<StagInt> vertices) {
+  std::vector<StagReal> degs;
+  degs.reserve(vertices.size());
+  for (StagInt v : vertices) degs.push_back(degree(v));
+  return degs;
+}
+
+std::vector<StagInt> stag::UnweightedGraph::degrees_unweighted(std::vector<StagInt> vertices) {
+  std::vector<StagInt> degs;
+  degs.reserve(vertices.size());
+  for (StagInt v : vertices) degs.push_back(degree_unweighted(v));
+  return degs;
+}
+
+bool stag::UnweightedGraph::vertex_exists(StagInt v) {
+  return v >= 0 && v < number_of_vertices_;
+}
+
+void stag::UnweightedGraph::check_vertex_argument(StagInt v) const {
+  if (v >= number_of_vertices_) {
+    throw std::invalid_argument("Specified vertex index too large.");
+  }
+  if (v < 0) {
+    throw std::invalid_argument("Vertex indices cannot be negative.");
+  }
+}
+
+//------------------------------------------------------------------------------
+// Equality Operators
+//------------------------------------------------------------------------------
+bool stag::operator==(const stag::Graph& lhs, const stag::Graph& rhs) {
+  // Graphs are compared without the tombstones of any removed edges.
+  if (lhs.number_of_tombstones() > 0 || rhs.number_of_tombstones() > 0) {
+    stag::Graph lhs_compact = lhs;
+    stag::Graph rhs_compact = rhs;
+    lhs_compact.compact();
+    rhs_compact.compact();
+    return lhs_compact == rhs_compact;
+  }
+
+  bool outerIndicesEqual = stag::sprsMatOuterStarts(lhs.adjacency()) == stag::sprsMatOuterStarts(rhs.adjacency());
+  bool innerIndicesEqual = stag::sprsMatInnerIndices(lhs.adjacency()) == stag::sprsMatInnerIndices(rhs.adjacency());
+  bool valuesEqual = stag::sprsMatValues(lhs.adjacency()) == stag::sprsMatValues(rhs.adjacency());
+  return (outerIndicesEqual && innerIndicesEqual) && valuesEqual;
+}
+
+bool stag::operator!=(const stag::Graph &lhs, const stag::Graph &rhs) {
+  return !(lhs == rhs);
+}
+
+bool stag::operator==(const stag::edge &lhs, const stag::edge &rhs) {
+  return lhs.v1 == rhs.v1 && lhs.v2 == rhs.v2 && lhs.weight == rhs.weight;
+}
+
+bool stag::operator!=(const stag::edge &lhs, const stag::edge &rhs) {
+  return !(lhs == rhs);
+}
+
+//------------------------------------------------------------------------------
+// Subgraph View
+//------------------------------------------------------------------------------
+stag::SubgraphView::SubgraphView(stag::LocalGraph* parent,
+                                 const std::vector<StagInt>& vertices)
+  : parent_(parent) {
+  // Remove duplicate vertices, keeping the first occurrence of each.
+  sorted_vertices_ = vertices;
+  std::sort(sorted_vertices_.begin(), sorted_vertices_.end());
+  sorted_vertices_.erase(std::unique(sorted_vertices_.begin(), sorted_vertices_.end()),
+                         sorted_vertices_.end());
+  for (StagInt v : sorted_vertices_) {
+    if (!parent_->vertex_exists(v)) {
+      throw std::invalid_argument("Subgraph vertices must be in the parent graph.");
+    }
+  }
+
+  if (sorted_vertices_.size() == vertices.size()) {
+    vertices_ = vertices;
+  } else {
+    std::vector<bool> seen(sorted_vertices_.size(), false);
+    vertices_.reserve(sorted_vertices_.size());
+    for (StagInt v : vertices) {
+      auto pos = std::lower_bound(sorted_vertices_.begin(), sorted_vertices_.end(), v)
+          - sorted_vertices_.begin();
+      if (!seen[pos]) {
+        seen[pos] = true;
+        vertices_.push_back(v);
+      }
+    }
+  }
+}
+
+stag::Graph stag::SubgraphView::materialise() {
+  // The local id of each vertex, in the order of the sorted vertices.
+  auto n = (StagInt) vertices_.size();
+  std::vector<StagInt> local_ids(n);
+  for (StagInt i = 0; i < n; i++) {
+    auto pos = std::lower_bound(sorted_vertices_.begin(), sorted_vertices_.end(),
+                                vertices_[i]) - sorted_vertices_.begin();
+    local_ids[pos] = i;
+  }
+
+  // Construct each column of the adjacency matrix from the filtered
+  // neighbors of the corresponding vertex.
+  std::vector<StagInt> outerStarts = {0};
+  std::vector<StagInt> innerIndices;
+  std::vector<StagReal> values;
+  std::vector<std::pair<StagInt, StagReal>> column;
+  outerStarts.reserve(n + 1);
+  for (StagInt i = 0; i < n; i++) {
+    column.clear();
+    for (stag::edge e : neighbors_view(vertices_[i])) {
+      auto pos = std::lower_bound(sorted_vertices_.begin(), sorted_vertices_.end(), e.v2)
+          - sorted_vertices_.begin();
+      column.emplace_back(local_ids[pos], e.weight);
+    }
+    std::sort(column.begin(), column.end());
+
+    for (auto& entry : column) {
+      innerIndices.push_back(entry.first);
+      values.push_back(entry.second);
+    }
+    outerStarts.push_back((StagInt) innerIndices.size());
+  }
+
+  return {outerStarts, innerIndices, values};
+}
+
+const std::vector<StagInt>& stag::SubgraphView::vertices() const {
+  return vertices_;
+}
+
+StagInt stag::SubgraphView::number_of_vertices() const {
+  return (StagInt) vertices_.size();
+}
+
+bool stag::SubgraphView::contains(StagInt v) const {
+  return std::binary_search(sorted_vertices_.begin(), sorted_vertices_.end(), v);
+}
+
+StagReal stag::SubgraphView::degree(StagInt v) {
+  // A self-loop is counted twice in the degree.
+  StagReal deg = 0;
+  for (stag::edge e : neighbors_view(v)) {
+    deg += e.v2 == v ? 2 * e.weight : e.weight;
+  }
+  return deg;
+}
+
+StagInt stag::SubgraphView::degree_unweighted(StagInt v) {
+  // A self-loop is counted twice in the degree.
+  StagInt deg = 0;
+  for (StagInt u : neighbors_view(v).ids()) {
+    deg += u == v ? 2 : 1;
+  }
+  return deg;
+}
+
+std::vector<stag::edge> stag::SubgraphView::neighbors(StagInt v) {
+  stag::NeighborView view = neighbors_view(v);
+  return {view.begin(), view.end()};
+}
+
+std::vector<StagInt> stag::SubgraphView::neighbors_unweighted(StagInt v) {
+  std::span<const StagInt> ids = neighbors_view(v).ids();
+  return {ids.begin(), ids.end()};
+}
+
+stag::NeighborView stag::SubgraphView::neighbors_view(StagInt v) {
+  check_vertex_argument(v);
+
+  // Copy the neighbors of v in the parent graph which are in the subgraph
+  // into the buffers owned by the LocalGraph base class.
+  view_ids_buffer_.clear();
+  view_weights_buffer_.clear();
+  stag::NeighborView parent_view = parent_->neighbors_view(v);
+  std::span<const StagInt> ids = parent_view.ids();
+  std::span<const StagReal> weights = parent_view.weights();
+  for (StagUInt k = 0; k < ids.size(); k++) {
+    if (contains(ids[k])) {
+      view_ids_buffer_.push_back(ids[k]);
+      view_weights_buffer_.push_back(weights[k]);
+    }
+  }
+
+  return {v, view_ids_buffer_.data(), view_weights_buffer_.data(),
+          (StagInt) view_ids_buffer_.size()};
+}
+
+std::vector<StagReal> stag::SubgraphView::degrees(std::vector<StagInt> vertices) {
+  std::vector<StagReal> degs;
+  degs.reserve(vertices.size());
+  for (StagInt v : vertices) degs.push_back(degree(v));
+  return degs;
+}
+
+std::vector<StagInt> stag::SubgraphView::degrees_unweighted(std::vector<StagInt> vertices) {
+  std::vector<StagInt> degs;
+  degs.reserve(vertices.size());
+  for (StagInt v : vertices) degs.push_back(degree_unweighted(v));
+  return degs;
+}
+
+bool stag::SubgraphView::vertex_exists(StagInt v) {
+  return contains(v);
+}
+
+void stag::SubgraphView::prefetch(std::span<const StagInt> vertices) {
+  parent_->prefetch(vertices);
+}
+
+void stag::SubgraphView::check_vertex_argument(StagInt v) const {
+  if (!contains(v)) {
+    throw std::invalid_argument("Vertex is not in the subgraph.");
+  }
+}
+
+//------------------------------------------------------------------------------
+// Neighborhood Cache
+//------------------------------------------------------------------------------
+bool stag::NeighborhoodCache::lookup(StagInt v, NeighborView* view) {
+  auto cached = slot_of_vertex_.find(v);
+  if (cached == slot_of_vertex_.end()) {
+    misses_++;
+    return false;
+  }
+
+  hits_++;
+  StagInt slot = cached->second;
+  unlink_(slot);
+  push_front_(slot);
+  const Slot& entry = slots_[slot];
+  *view = {v, ids_.data() + entry.offset, weights_.data() + entry.offset,
+           entry.size};
+  return true;
+}
+
+bool stag::NeighborhoodCache::contains(StagInt v) const {
+  return slot_of_vertex_.contains(v);
+}
+
+stag::NeighborView stag::NeighborhoodCache::insert(StagInt v,
+                                                   const std::vector<edge>& edges) {
+  auto size = (StagInt) edges.size();
+  StagUInt bytes = entry_bytes_(size);
+
+  // If another copy of the neighborhood has been cached since the caller
+  // looked it up, keep that copy.
+  auto cached = slot_of_vertex_.find(v);
+  if (cached != slot_of_vertex_.end()) {
+    StagInt slot = cached->second;
+    unlink_(slot);
+    push_front_(slot);
+    const Slot& entry = slots_[slot];
+    return {v, ids_.data() + entry.offset, weights_.data() + entry.offset,
+            entry.size};
+  }
+
+  // Make room for the new neighborhood.
+  while (tail_ >= 0 && memory_usage_ + bytes > budget_) evict_(tail_);
+  if (dead_entries_ > live_entries_) compact_();
+
+  // Append the neighborhood to the end of the arrays.
+  StagInt offset = (StagInt) ids_.size();
+  for (const stag::edge& e : edges) {
+    ids_.push_back(e.v2);
+    weights_.push_back(e.weight);
+  }
+  live_entries_ += size;
+  memory_usage_ += bytes;
+
+  StagInt slot;
+  if (free_slots_.empty()) {
+    slot = (StagInt) slots_.size();
+    slots_.emplace_back();
+  } else {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  }
+  slots_[slot] = {v, offset, size, -1, -1};
+  push_front_(slot);
+  slot_of_vertex_[v] = slot;
+
+  return {v, ids_.data() + offset, weights_.data() + offset, size};
+}
+
+void stag::NeighborhoodCache::set_budget(StagUInt bytes) {
+  budget_ = bytes;
+  while (tail_ >= 0 && memory_usage_ > budget_) evict_(tail_);
+  if (dead_entries_ > live_entries_) compact_();
+}
+
+StagUInt stag::NeighborhoodCache::budget() const {
+  return budget_;
+}
+
+void stag::NeighborhoodCache::clear() {
+  std::vector<StagInt>().swap(ids_);
+  std::vector<StagReal>().swap(weights_);
+  std::vector<Slot>().swap(slots_);
+  std::vector<StagInt>().swap(free_slots_);
+  slot_of_vertex_.clear();
+  live_entries_ = 0;
+  dead_entries_ = 0;
+  head_ = -1;
+  tail_ = -1;
+  memory_usage_ = 0;
+}
+
+stag::NeighborhoodCacheStats stag::NeighborhoodCache::stats() const {
+  return {hits_, misses_, evictions_, slot_of_vertex_.size(), memory_usage_};
+}
+
+StagUInt stag::NeighborhoodCache::entry_bytes_(StagInt size) const {
+  // Each entry uses a slot and an entry in the hash map, as well as the
+  // space for its neighbors.
+  return size * (sizeof(StagInt) + sizeof(StagReal)) + sizeof(Slot) +
+         sizeof(std::pair<const StagInt, StagInt>);
+}
+
+void stag::NeighborhoodCache::unlink_(StagInt slot) {
+  Slot& entry = slots_[slot];
+  if (entry.prev >= 0) slots_[entry.prev].next = entry.next;
+  else head_ = entry.next;
+  if (entry.next >= 0) slots_[entry.next].prev = entry.prev;
+  else tail_ = entry.prev;
+  entry.prev = -1;
+  entry.next = -1;
+}
+
+void stag::NeighborhoodCache::push_front_(StagInt slot) {
+  slots_[slot].prev = -1;
+  slots_[slot].next = head_;
+  if (head_ >= 0) slots_[head_].prev = slot;
+  head_ = slot;
+  if (tail_ < 0) tail_ = slot;
+}
+
+void stag::NeighborhoodCache::evict_(StagInt slot) {
+  unlink_(slot);
+  Slot& entry = slots_[slot];
+  slot_of_vertex_.erase(entry.vertex);
+  live_entries_ -= entry.size;
+  dead_entries_ += entry.size;
+  memory_usage_ -= entry_bytes_(entry.size);
+  free_slots_.push_back(slot);
+  evictions_++;
+}
+
+void stag::NeighborhoodCache::compact_() {
+  // Move the cached neighborhoods to the start of the arrays, in order of
+  // their current position so that no neighborhood is overwritten before
+  // it is moved.
+  std::vector<StagInt> live_slots;
+  live_slots.reserve(slot_of_vertex_.size());
+  for (StagInt slot = head_; slot >= 0; slot = slots_[slot].next) {
+    live_slots.push_back(slot);
+  }
+  std::sort(live_slots.begin(), live_slots.end(), [&](StagInt a, StagInt b) {
+    return slots_[a].offset < slots_[b].offset;
+  });
+
+  StagInt end = 0;
+  for (StagInt slot : live_slots) {
+    Slot& entry = slots_[slot];
+    std::copy(ids_.begin() + entry.offset,
+              ids_.begin() + entry.offset + entry.size, ids_.begin() + end);
+    std::copy(weights_.begin() + entry.offset,
+              weights_.begin() + entry.offset + entry.size, weights_.begin() + end);
+    entry.offset = end;
+    end += entry.size;
+  }
+  ids_.resize(end);
+  weights_.resize(end);
+  dead_entries_ = 0;
+}
+
+//------------------------------------------------------------------------------
+// Adjacency List Local Graph
+//------------------------------------------------------------------------------
+/**
+ * Parse the node ID at the start of a line of an adjacencylist file.
+ *
+ * @param start pointer to the first character of the line
+ * @param end pointer to the end of the line
+ * @return the node ID, or -1 if the line is blank or a comment
+ * @throws std::runtime_error if the line is not a valid content line
+ */
+StagInt parse_adjacencylist_node_id(const char* start, const char* end) {
+  while (start < end && (*start == ' ' || *start == '\t' || *start == '\r')) start++;
+  if (start == end || *start == '#' || *start == '/') return -1;
+
+  StagInt node_id = -1;
+  std::from_chars_result result = std::from_chars(start, end, node_id);
+  const char* separator = result.ptr;
+  while (separator < end && (*separator == ' ' || *separator == '\t')) separator++;
+  if (result.ec != std::errc() || separator == end || *separator != ':') {
+    throw std::runtime_error("Malformed adjacencylist file.");
+  }
+  return node_id;
+}
+
+#define ADJACENCYLIST_INDEX_MAGIC "STAGIDX"
+#define ADJACENCYLIST_INDEX_VERSION 1
+#define ADJACENCYLIST_INDEX_BYTE_ORDER 0x01020304
+
+/**
+ * The header at the start of an adjacencylist index file.
+ *
+ * If the node IDs are not dense, the header is followed by the
+ * number_of_nodes sorted node IDs. This is followed by the number_of_nodes
+ * offsets of the content lines of the nodes.
+ */
+struct AdjacencyListIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t adjacencylist_size;
+  int64_t adjacencylist_mtime;
+  int64_t number_of_nodes;
+  uint32_t dense;
+  uint32_t reserved_flags;
+  int64_t reserved[2];
+};
+static_assert(sizeof(AdjacencyListIndexHeader) == 64,
+              "The adjacencylist index header must be 64 bytes.");
+
+/**
+ * The modification time of a file, used to check whether an index file is
+ * out of date.
+ */
+int64_t file_modification_time(const std::string& filename) {
+  std::error_code error;
+  auto mtime = std::filesystem::last_write_time(filename, error);
+  if (error) return 0;
+  return (int64_t) mtime.time_since_epoch().count();
+}
+
+stag::AdjacencyListFile::AdjacencyListFile(const std::string &filename)
+    : filename_(filename), file_(filename) {
+  if (!load_index_()) build_index_();
+}
+
+void stag::AdjacencyListFile::build_index_() {
+  const char* data = file_.data();
+  const char* end_of_file = data + file_.size();
+
+  // Make a single pass over the lines of the file. The node IDs are stored
+  // only once we find that they are not 0, 1, 2, ...
+  StagInt last_id = -1;
+  bool dense = true;
+  const char* line = data;
+  while (line < end_of_file) {
+    auto line_end = (const char*) std::memchr(line, '\n', end_of_file - line);
+    if (line_end == nullptr) line_end = end_of_file;
+
+    StagInt node_id = parse_adjacencylist_node_id(line, line_end);
+    if (node_id >= 0) {
+      if (node_id <= last_id) {
+        throw std::runtime_error("Adjacencylist file must be sorted by node ID.");
+      }
+      if (dense && node_id != (StagInt) index_offset_storage_.size()) {
+        dense = false;
+        index_id_storage_.resize(index_offset_storage_.size());
+        std::iota(index_id_storage_.begin(), index_id_storage_.end(), 0);
+      }
+      if (!dense) index_id_storage_.push_back(node_id);
+      index_offset_storage_.push_back(line - data);
+      last_id = node_id;
+    }
+
+    line = line_end + 1;
+  }
+
+  index_id_storage_.shrink_to_fit();
+  index_offset_storage_.shrink_to_fit();
+  index_ids_ = dense ? nullptr : index_id_storage_.data();
+  index_offsets_ = index_offset_storage_.data();
+  index_size_ = (StagInt) index_offset_storage_.size();
+}
+
+bool stag::AdjacencyListFile::load_index_() {
+  std::string index_filename = filename_ + ".idx";
+  if (!std::filesystem::exists(index_filename)) return false;
+
+  // An index which cannot be read, or which does not match the current
+  // adjacencylist file, is ignored.
+  try {
+    stag::MappedFile index_file(index_filename);
+    AdjacencyListIndexHeader header = {};
+    if (index_file.size() < sizeof(header)) return false;
+    std::memcpy(&header, index_file.data(), sizeof(header));
+
+    if (std::strncmp(header.magic, ADJACENCYLIST_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != ADJACENCYLIST_INDEX_VERSION ||
+        header.byte_order != ADJACENCYLIST_INDEX_BYTE_ORDER ||
+        header.adjacencylist_size != file_.size() ||
+        header.adjacencylist_mtime != file_modification_time(filename_) ||
+        header.number_of_nodes < 0 ||
+        (StagUInt) header.number_of_nodes > file_.size()) {
+      return false;
+    }
+    StagUInt arrays = header.dense ? 1 : 2;
+    StagUInt expected_size = sizeof(header) +
+        arrays * header.number_of_nodes * sizeof(StagInt);
+    if (index_file.size() != expected_size) return false;
+
+    // The arrays follow the header, and are aligned to 8 bytes. Reading the
+    // whole index here would defeat the point of saving it, so each entry is
+    // checked against the adjacencylist file only when it is used.
+    index_size_ = header.number_of_nodes;
+    auto arrays_start = (const StagInt*) (index_file.data() + sizeof(header));
+    index_ids_ = header.dense ? nullptr : arrays_start;
+    index_offsets_ = header.dense ? arrays_start : arrays_start + index_size_;
+    index_file_ = std::move(index_file);
+    return true;
+  } catch (std::runtime_error& e) {
+    return false;
+  }
+}
+
+void stag::AdjacencyListFile::save_index() const {
+  // The index file is already up to date if it was loaded.
+  if (index_loaded()) return;
+
+  AdjacencyListIndexHeader header = {};
+  std::strncpy(header.magic, ADJACENCYLIST_INDEX_MAGIC, sizeof(header.magic));
+  header.version = ADJACENCYLIST_INDEX_VERSION;
+  header.byte_order = ADJACENCYLIST_INDEX_BYTE_ORDER;
+  header.adjacencylist_size = file_.size();
+  header.adjacencylist_mtime = file_modification_time(filename_);
+  header.number_of_nodes = index_size_;
+  header.dense = index_ids_ == nullptr ? 1 : 0;
+
+  // Write the index to a temporary file, and then rename it, so that other
+  // processes never see a partially written index.
+  std::string index_filename = filename_ + ".idx";
+  std::string temp_filename = index_filename + ".tmp";
+  std::ofstream os(temp_filename, std::ios::binary);
+  if (!os.is_open()) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  os.write((const char*) &header, sizeof(header));
+  if (index_ids_ != nullptr) {
+    os.write((const char*) index_ids_, index_size_ * sizeof(StagInt));
+  }
+  os.write((const char*) index_offsets_, index_size_ * sizeof(StagInt));
+  os.close();
+  if (os.fail()) {
+    std::filesystem::remove(temp_filename);
+    throw std::runtime_error("Failed to write index file " + index_filename);
+  }
+  std::filesystem::rename(temp_filename, index_filename);
+}
+
+bool stag::AdjacencyListFile::index_loaded() const {
+  return index_file_.size() > 0;
+}
+
+StagInt stag::AdjacencyListFile::index_offset_(StagInt i) const {
+  // A saved index may have been corrupted, so check that the entry is
+  // consistent with its neighbours in the index and with the file.
+  StagInt offset = index_offsets_[i];
+  StagInt file_size = (StagInt) file_.size();
+  bool valid = offset >= 0 && offset < file_size &&
+      (offset == 0 || file_.data()[offset - 1] == '\n') &&
+      (i == 0 || index_offsets_[i - 1] < offset) &&
+      (i + 1 == index_size_ ||
+       (offset < index_offsets_[i + 1] && index_offsets_[i + 1] < file_size));
+  if (valid && index_ids_ != nullptr) {
+    valid = (i == 0 || index_ids_[i - 1] < index_ids_[i]) &&
+        (i + 1 == index_size_ || index_ids_[i] < index_ids_[i + 1]);
+  }
+  if (!valid) {
+    throw std::runtime_error("Adjacencylist index file is corrupted.");
+  }
+  return offset;
+}
+
+StagInt stag::AdjacencyListFile::find_vertex(StagInt v) const {
+  StagInt position = 0;
+  return find_vertex(v, &position);
+}
+
+StagInt stag::AdjacencyListFile::find_vertex(StagInt v, StagInt* position) const {
+  if (index_ids_ == nullptr) {
+    if (v < 0 || v >= index_size_) return -1;
+    return index_offset_(v);
+  }
+
+  // Gallop forward from the given position to find a bracket containing v,
+  // and then binary search within the bracket.
+  StagInt low = std::clamp<StagInt>(*position, 0, index_size_);
+  if (low > 0 && index_ids_[low - 1] >= v) low = 0;
+  StagInt high = low;
+  StagInt step = 1;
+  while (high < index_size_ && index_ids_[high] < v) {
+    low = high + 1;
+    high += step;
+    step *= 2;
+  }
+  high = std::min(high + 1, index_size_);
+
+  const StagInt* it = std::lower_bound(index_ids_ + low, index_ids_ + high, v);
+  *position = it - index_ids_;
+  if (it == index_ids_ + index_size_ || *it != v) return -1;
+  return index_offset_(it - index_ids_);
+}
+
+std::vector<stag::edge> stag::AdjacencyListFile::read_neighborhood(StagInt v) const {
+  // First, find the target vertex in the adjacencylist file.
+  StagInt offset = find_vertex(v);
+  if (offset < 0) {
+    throw std::runtime_error("Couldn't find node in adjacencylist file.");
+  }
+  return read_content_line(offset);
+}
+
+std::vector<stag::edge> stag::AdjacencyListFile::read_content_line(StagInt offset) const {
+  if (offset < 0 || (StagUInt) offset >= file_.size()) {
+    throw std::runtime_error("Content line is outside of the adjacencylist file.");
+  }
+
+  // Parse the content line to get the neighbours.
+  const char* line = file_.data() + offset;
+  const char* end_of_file = file_.data() + file_.size();
+  auto line_end = (const char*) std::memchr(line, '\n', end_of_file - line);
+  if (line_end == nullptr) line_end = end_of_file;
+  if (line_end > line && *(line_end - 1) == '\r') line_end--;
+  return stag::parse_adjacencylist_content_line(std::string(line, line_end));
+}
+
+/**
+ * The positions of the given vertices, in increasing order of vertex id.
+ */
+std::vector<StagInt> sorted_order(const std::vector<StagInt>& vertices) {
+  std::vector<StagInt> order(vertices.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&vertices](StagInt a, StagInt b) {
+    return vertices[a] < vertices[b];
+  });
+  return order;
+}
+
+/**
+ * The weighted degree of the vertex v with the given neighborhood.
+ */
+StagReal neighborhood_degree(StagInt v, const stag::NeighborView& view) {
+  StagReal deg = 0;
+  for (stag::edge e : view) {
+    // Self-loops count twice towards the degree
+    if (e.v2 == v) deg += 2 * e.weight;
+    else deg += e.weight;
+  }
+  return deg;
+}
+
+void stag::AdjacencyListFile::prefetch(std::span<const StagInt> vertices) const {
+  // Find the vertices in sorted order, and merge the content lines which
+  // are next to each other in the file into a single range.
+  std::vector<StagInt> sorted(vertices.begin(), vertices.end());
+  std::sort(sorted.begin(), sorted.end());
+  StagInt position = 0;
+  StagUInt range_start = 0;
+  StagUInt range_end = 0;
+  for (StagInt v : sorted) {
+    StagInt offset = find_vertex(v, &position);
+    if (offset < 0) continue;
+
+    // The content line ends before the content line of the next node.
+    StagInt next = (index_ids_ == nullptr ? v : position) + 1;
+    StagUInt end = next < index_size_ ? index_offsets_[next] : file_.size();
+
+    if ((StagUInt) offset > range_end) {
+      file_.prefetch(range_start, range_end - range_start);
+      range_start = offset;
+    }
+    range_end = std::max(range_end, end);
+  }
+  file_.prefetch(range_start, range_end - range_start);
+}
+
+stag::AdjacencyListLocalGraph::AdjacencyListLocalGraph(const std::string &filename)
+    : file_(filename) {}
+
+void stag::AdjacencyListLocalGraph::save_index() const {
+  file_.save_index();
+}
+
+bool stag::AdjacencyListLocalGraph::index_loaded() const {
+  return file_.index_loaded();
+}
+
+void stag::AdjacencyListLocalGraph::set_cache_budget(StagUInt bytes) {
+  cache_.set_budget(bytes);
+}
+
+StagUInt stag::AdjacencyListLocalGraph::cache_budget() const {
+  return cache_.budget();
+}
+
+stag::NeighborhoodCacheStats stag::AdjacencyListLocalGraph::cache_stats() const {
+  return cache_.stats();
+}
+
+void stag::AdjacencyListLocalGraph::clear_cache() {
+  cache_.clear();
+}
+
+stag::NeighborView stag::AdjacencyListLocalGraph::load_neighborhood(StagInt v) {
+  StagInt position = 0;
+  return load_neighborhood(v, &position);
+}
+
+stag::NeighborView stag::AdjacencyListLocalGraph::load_neighborhood(StagInt v,
+                                                                    StagInt* position) {
+  // If the neighborhood of this vertex is in the cache, just return the
+  // cached copy.
+  stag::NeighborView cached;
+  if (cache_.lookup(v, &cached)) return cached;
+
+  // Otherwise, read it from the file and add it to the cache.
+  StagInt offset = file_.find_vertex(v, position);
+  if (offset < 0) {
+    throw std::runtime_error("Couldn't find node in adjacencylist file.");
+  }
+  return cache_.insert(v, file_.read_content_line(offset));
+}
+
+stag::NeighborView stag::AdjacencyListLocalGraph::neighbors_view(StagInt v) {
+  // The view points into the cache, and remains valid until another
+  // neighborhood is loaded.
+  return load_neighborhood(v);
+}
+
+std::vector<stag::edge> stag::AdjacencyListLocalGraph::neighbors(StagInt v) {
+  stag::NeighborView view = neighbors_view(v);
+  return {view.begin(), view.end()};
+}
+
+std::vector<StagInt> stag::AdjacencyListLocalGraph::neighbors_unweighted(StagInt v) {
+  std::span<const StagInt> ids = load_neighborhood(v).ids();
+  return {ids.begin(), ids.end()};
+}
+
+StagReal stag::AdjacencyListLocalGraph::degree(StagInt v) {
+  return neighborhood_degree(v, load_neighborhood(v));
+}
+
+StagInt stag::AdjacencyListLocalGraph::degree_unweighted(StagInt v) {
+  return load_neighborhood(v).size();
+}
+
+std::vector<StagReal> stag::AdjacencyListLocalGraph::degrees(std::vector<StagInt> vertices) {
+  // Visit the vertices in sorted order, so that the index is searched in a
+  // single forward sweep.
+  std::vector<StagReal> degs(vertices.size());
+  StagInt position = 0;
+  for (StagInt i : sorted_order(vertices)) {
+    StagInt v = vertices[i];
+    degs[i] = neighborhood_degree(v, load_neighborhood(v, &position));
+  }
+  return degs;
+}
+
+std::vector<StagInt> stag::AdjacencyListLocalGraph::degrees_unweighted(std::vector<StagInt> vertices) {
+  std::vector<StagInt> degs(vertices.size());
+  StagInt position = 0;
+  for (StagInt i : sorted_order(vertices)) {
+    degs[i] = load_neighborhood(vertices[i], &position).size();
+  }
+  return degs;
+}
+
+bool stag::AdjacencyListLocalGraph::vertex_exists(StagInt v) {
+  return file_.find_vertex(v) >= 0;
+}
+
+void stag::AdjacencyListLocalGraph::prefetch(std::span<const StagInt> vertices) {
+  // Cached neighborhoods do not need to be read again.
+  std::vector<StagInt> uncached;
+  for (StagInt v : vertices) {
+    if (!cache_.contains(v)) uncached.push_back(v);
+  }
+  file_.prefetch(uncached);
+}
+
+//------------------------------------------------------------------------------
+// Concurrent Adjacency List Local Graph
+//------------------------------------------------------------------------------
+#define DEFAULT_NUM_CACHE_SHARDS 64
+
+// The neighborhoods returned by ConcurrentAdjacencyListLocalGraph::neighbors_view
+// are copied into buffers owned by the calling thread, since another thread
+// may evict the cached copy at any time.
+thread_local std::vector<StagInt> concurrent_view_ids;
+thread_local std::vector<StagReal> concurrent_view_weights;
+
+stag::ConcurrentAdjacencyListLocalGraph::ConcurrentAdjacencyListLocalGraph(
+    const std::string &filename)
+    : ConcurrentAdjacencyListLocalGraph(filename, DEFAULT_NUM_CACHE_SHARDS) {}
+
+stag::ConcurrentAdjacencyListLocalGraph::ConcurrentAdjacencyListLocalGraph(
+    const std::string &filename, StagInt num_shards)
+    : file_(filename) {
+  if (num_shards <= 0) {
+    throw std::invalid_argument("Number of cache shards must be positive.");
+  }
+  shards_ = std::vector<CacheShard>(num_shards);
+}
+
+void stag::ConcurrentAdjacencyListLocalGraph::save_index() const {
+  file_.save_index();
+}
+
+bool stag::ConcurrentAdjacencyListLocalGraph::index_loaded() const {
+  return file_.index_loaded();
+}
+
+void stag::ConcurrentAdjacencyListLocalGraph::set_cache_budget(StagUInt bytes) {
+  cache_budget_ = bytes;
+  StagUInt shard_budget = bytes / shards_.size();
+  if (bytes == std::numeric_limits<StagUInt>::max()) shard_budget = bytes;
+  for (CacheShard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache.set_budget(shard_budget);
+  }
+}
+
+StagUInt stag::ConcurrentAdjacencyListLocalGraph::cache_budget() const {
+  return cache_budget_;
+}
+
+stag::NeighborhoodCacheStats stag::ConcurrentAdjacencyListLocalGraph::cache_stats() const {
+  stag::NeighborhoodCacheStats total = {0, 0, 0, 0, 0};
+  for (const CacheShard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stag::NeighborhoodCacheStats stats = shard.cache.stats();
+    total.hits += stats.hits;
+    total.misses += stats.misses;
+    total.evictions += stats.evictions;
+    total.cached_vertices += stats.cached_vertices;
+    total.memory_usage += stats.memory_usage;
+  }
+  return total;
+}
+
+void stag::ConcurrentAdjacencyListLocalGraph::clear_cache() {
+  for (CacheShard& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.cache.clear();
+  }
+}
+
+template <typename Function>
+auto stag::ConcurrentAdjacencyListLocalGraph::with_neighborhood(StagInt v,
+                                                                StagInt* position,
+                                                                Function f) {
+  // Find the vertex before choosing a shard, so that negative vertex ids are
+  // rejected.
+  StagInt offset = file_.find_vertex(v, position);
+  if (offset < 0) {
+    throw std::runtime_error("Couldn't find node in adjacencylist file.");
+  }
+  CacheShard& shard = shards_[v % shards_.size()];
+
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stag::NeighborView cached;
+    if (shard.cache.lookup(v, &cached)) return f(cached);
+  }
+
+  // Parse the neighborhood without holding the lock, so that other threads
+  // can use the shard in the meantime.
+  std::vector<stag::edge> edges = file_.read_content_line(offset);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return f(shard.cache.insert(v, edges));
+}
+
+template <typename Function>
+auto stag::ConcurrentAdjacencyListLocalGraph::with_neighborhood(StagInt v,
+                                                                Function f) {
+  StagInt position = 0;
+  return with_neighborhood(v, &position, f);
+}
+
+stag::NeighborView stag::ConcurrentAdjacencyListLocalGraph::neighbors_view(StagInt v) {
+  return with_neighborhood(v, [v](stag::NeighborView view) {
+    concurrent_view_ids.assign(view.ids().begin(), view.ids().end());
+    concurrent_view_weights.assign(view.weights().begin(), view.weights().end());
+    return stag::NeighborView{v, concurrent_view_ids.data(),
+                              concurrent_view_weights.data(), view.size()};
+  });
+}
+
+std::vector<stag::edge> stag::ConcurrentAdjacencyListLocalGraph::neighbors(StagInt v) {
+  return with_neighborhood(v, [](stag::NeighborView view) {
+    return std::vector<stag::edge>(view.begin(), view.end());
+  });
+}
+
+std::vector<StagInt> stag::ConcurrentAdjacencyListLocalGraph::neighbors_unweighted(StagInt v) {
+  return with_neighborhood(v, [](stag::NeighborView view) {
+    return std::vector<StagInt>(view.ids().begin(), view.ids().end());
+  });
+}
+
+StagReal stag::ConcurrentAdjacencyListLocalGraph::degree(StagInt v) {
+  return with_neighborhood(v, [v](stag::NeighborView view) {
+    return neighborhood_degree(v, view);
+  });
+}
+
+StagInt stag::ConcurrentAdjacencyListLocalGraph::degree_unweighted(StagInt v) {
+  return with_neighborhood(v, [](stag::NeighborView view) {
+    return view.size();
+  });
+}
+
+std::vector<StagReal> stag::ConcurrentAdjacencyListLocalGraph::degrees(std::vector<StagInt> vertices) {
+  // Visit the vertices in sorted order, so that the index is searched in a
+  // single forward sweep.
+  std::vector<StagReal> degs(vertices.size());
+  StagInt position = 0;
+  for (StagInt i : sorted_order(vertices)) {
+    StagInt v = vertices[i];
+    degs[i] = with_neighborhood(v, &position, [v](stag::NeighborView view) {
+      return neighborhood_degree(v, view);
+    });
+  }
+  return degs;
+}
+
+std::vector<StagInt> stag::ConcurrentAdjacencyListLocalGraph::degrees_unweighted(std::vector<StagInt> vertices) {
+  std::vector<StagInt> degs(vertices.size());
+  StagInt position = 0;
+  for (StagInt i : sorted_order(vertices)) {
+    degs[i] = with_neighborhood(vertices[i], &position,
+                                [](stag::NeighborView view) {
+      return view.size();
+    });
+  }
+  return degs;
+}
+
+bool stag::ConcurrentAdjacencyListLocalGraph::vertex_exists(StagInt v) {
+  return file_.find_vertex(v) >= 0;
+}
+
+void stag::ConcurrentAdjacencyListLocalGraph::prefetch(std::span<const StagInt> vertices) {
+  // Don't check the cache, to avoid taking the lock of every shard.
+  file_.prefetch(vertices);
+}
+
+//------------------------------------------------------------------------------
+// Sharded Local Graph
+//------------------------------------------------------------------------------
+/**
+ * Read the shards listed in a manifest file.
+ *
+ * @throws std::runtime_error if the manifest cannot be read
+ */
+std::vector<stag::LocalGraphShard> read_shard_manifest(const std::string& filename) {
+  std::ifstream is(filename);
+  if (!is.is_open()) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+
+  // Relative filenames are relative to the directory of the manifest.
+  std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+
+  std::vector<stag::LocalGraphShard> shards;
+  std::string line;
+  while (stag::safeGetline(is, line)) {
+    if (line.length() == 0 || line[0] == '#' || line[0] == '/') continue;
+
+    std::istringstream tokens(line);
+    stag::LocalGraphShard shard;
+    std::string shard_filename;
+    if (!(tokens >> shard.first_vertex >> shard.last_vertex) ||
+        !std::getline(tokens >> std::ws, shard_filename) ||
+        shard_filename.empty()) {
+      throw std::runtime_error("Couldn't parse line of shard manifest: " + line);
+    }
+    std::filesystem::path shard_path(shard_filename);
+    if (shard_path.is_relative()) shard_path = directory / shard_path;
+    shard.filename = shard_path.string();
+    shards.push_back(shard);
+  }
+  return shards;
+}
+
+stag::ShardedLocalGraph::ShardedLocalGraph(const std::string& manifest_filename)
+    : ShardedLocalGraph(read_shard_manifest(manifest_filename)) {}
+
+stag::ShardedLocalGraph::ShardedLocalGraph(std::vector<LocalGraphShard> shards)
+    : shards_(std::move(shards)) {
+  std::sort(shards_.begin(), shards_.end(),
+            [](const LocalGraphShard& a, const LocalGraphShard& b) {
+              return a.first_vertex < b.first_vertex;
+            });
+  for (StagUInt i = 0; i < shards_.size(); i++) {
+    if (shards_[i].last_vertex < shards_[i].first_vertex) {
+      throw std::runtime_error("Shard " + shards_[i].filename +
+                               " has an empty vertex range.");
+    }
+    if (i > 0 && shards_[i].first_vertex <= shards_[i - 1].last_vertex) {
+      throw std::runtime_error("The vertex ranges of shards " +
+                               shards_[i - 1].filename + " and " +
+                               shards_[i].filename + " overlap.");
+    }
+  }
+  files_.resize(shards_.size());
+}
+
+const std::vector<stag::LocalGraphShard>& stag::ShardedLocalGraph::shards() const {
+  return shards_;
+}
+
+void stag::ShardedLocalGraph::set_cache_budget(StagUInt bytes) {
+  cache_.set_budget(bytes);
+}
+
+StagUInt stag::ShardedLocalGraph::cache_budget() const {
+  return cache_.budget();
+}
+
+stag::NeighborhoodCacheStats stag::ShardedLocalGraph::cache_stats() const {
+  return cache_.stats();
+}
+
+void stag::ShardedLocalGraph::clear_cache() {
+  cache_.clear();
+}
+
+StagInt stag::ShardedLocalGraph::find_shard(StagInt v) const {
+  // Find the last shard beginning at or before v.
+  auto it = std::upper_bound(shards_.begin(), shards_.end(), v,
+                             [](StagInt v, const LocalGraphShard& shard) {
+                               return v < shard.first_vertex;
+                             });
+  if (it == shards_.begin()) return -1;
+  it--;
+  if (v > it->last_vertex) return -1;
+  return it - shards_.begin();
+}
+
+const stag::AdjacencyListFile& stag::ShardedLocalGraph::shard_file(StagInt shard) {
+  if (files_[shard] == nullptr) {
+    files_[shard] = std::make_unique<AdjacencyListFile>(shards_[shard].filename);
+  }
+  return *files_[shard];
+}
+
+stag::NeighborView stag::ShardedLocalGraph::load_neighborhood(StagInt v,
+                                                              StagInt* position) {
+  // If the neighborhood of this vertex is in the cache, just return the
+  // cached copy.
+  stag::NeighborView cached;
+  if (cache_.lookup(v, &cached)) return cached;
+
+  // Otherwise, read it from its shard and add it to the cache.
+  StagInt shard = find_shard(v);
+  StagInt offset = shard < 0 ? -1 : shard_file(shard).find_vertex(v, position);
+  if (offset < 0) {
+    throw std::runtime_error("Couldn't find node in any shard.");
+  }
+  return cache_.insert(v, shard_file(shard).read_content_line(offset));
+}
+
+stag::NeighborView stag::ShardedLocalGraph::neighbors_view(StagInt v) {
+  // The view points into the cache, and remains valid until another
+  // neighborhood is loaded.
+  StagInt position = 0;
+  return load_neighborhood(v, &position);
+}
+
+std::vector<stag::edge> stag::ShardedLocalGraph::neighbors(StagInt v) {
+  stag::NeighborView view = neighbors_view(v);
+  return {view.begin(), view.end()};
+}
+
+std::vector<StagInt> stag::ShardedLocalGraph::neighbors_unweighted(StagInt v) {
+  std::span<const StagInt> ids = neighbors_view(v).ids();
+  return {ids.begin(), ids.end()};
+}
+
+StagReal stag::ShardedLocalGraph::degree(StagInt v) {
+  return neighborhood_degree(v, neighbors_view(v));
+}
+
+StagInt stag::ShardedLocalGraph::degree_unweighted(StagInt v) {
+  return neighbors_view(v).size();
+}
+
+std::vector<StagReal> stag::ShardedLocalGraph::degrees(std::vector<StagInt> vertices) {
+  // Visit the vertices in sorted order, so that the index of each shard is
+  // searched in a single forward sweep. The search restarts whenever the
+  // vertices move on to the next shard.
+  std::vector<StagReal> degs(vertices.size());
+  StagInt shard = -1;
+  StagInt position = 0;
+  for (StagInt i : sorted_order(vertices)) {
+    StagInt v = vertices[i];
+    if (shard < 0 || v > shards_[shard].last_vertex) {
+      shard = find_shard(v);
+      position = 0;
+    }
+    degs[i] = neighborhood_degree(v, load_neighborhood(v, &position));
+  }
+  return degs;
+}
+
+std::vector<StagInt> stag::ShardedLocalGraph::degrees_unweighted(std::vector<StagInt> vertices) {
+  std::vector<StagInt> degs(vertices.size());
+  StagInt shard = -1;
+  StagInt position = 0;
+  for (StagInt i : sorted_order(vertices)) {
+    StagInt v = vertices[i];
+    if (shard < 0 || v > shards_[shard].last_vertex) {
+      shard = find_shard(v);
+      position = 0;
+    }
+    degs[i] = load_neighborhood(v, &position).size();
+  }
+  return degs;
+}
+
+bool stag::ShardedLocalGraph::vertex_exists(StagInt v) {
+  StagInt shard = find_shard(v);
+  return shard >= 0 && shard_file(shard).find_vertex(v) >= 0;
+}
+
+void stag::ShardedLocalGraph::prefetch(std::span<const StagInt> vertices) {
+  // Group the uncached vertices by their shard.
+  std::vector<StagInt> uncached;
+  for (StagInt v : vertices) {
+    if (!cache_.contains(v) && find_shard(v) >= 0) uncached.push_back(v);
+  }
+  std::sort(uncached.begin(), uncached.end());
+
+  auto begin = uncached.begin();
+  while (begin != uncached.end()) {
+    StagInt shard = find_shard(*begin);
+    auto end = std::upper_bound(begin, uncached.end(),
+                                shards_[shard].last_vertex);
+    shard_file(shard).prefetch(std::span<const StagInt>(begin, end));
+    begin = end;
+  }
 }
 
 //------------------------------------------------------------------------------
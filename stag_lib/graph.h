@@ -12,8 +12,13 @@
 #define STAG_LIBRARY_H
 
 #include <vector>
+#include <span>
 #include <fstream>
 #include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <limits>
+#include <memory>
 
 #include "definitions.h"
 
@@ -39,6 +44,135 @@ namespace stag {
     StagReal weight;
   };
 
+  /**
+   * \brief A non-owning view of the neighborhood of a vertex in a graph.
+   *
+   * The view refers directly to the memory in which a graph stores the
+   * neighborhood of a vertex, and so it can be constructed and iterated
+   * without allocating any memory.
+   * Iterating over the view yields stag::edge objects with the ordering
+   * (v, x) such that edge.v1 = v.
+   *
+   * \code{.cpp}
+   *     #include <iostream>
+   *     #include <stag/graph.h>
+   *
+   *     int main() {
+   *       stag::Graph myGraph = stag::cycle_graph(10);
+   *
+   *       for (stag::edge e : myGraph.neighbors_view(0)) {
+   *         std::cout << e.v2 << ": " << e.weight << std::endl;
+   *       }
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   *
+   * The view is only valid until the graph which created it is modified.
+   * See stag::LocalGraph::neighbors_view for more information.
+   */
+  class NeighborView {
+    public:
+      /**
+       * \brief Iterator over the edges in a stag::NeighborView.
+       */
+      class iterator {
+        public:
+          /**
+           * \cond
+           */
+          using iterator_category = std::forward_iterator_tag;
+          using difference_type = std::ptrdiff_t;
+          using value_type = edge;
+          using pointer = void;
+          using reference = edge;
+
+          iterator() = default;
+          iterator(const NeighborView* view, StagInt pos) : view_(view), pos_(pos) {}
+          edge operator*() const { return (*view_)[pos_]; }
+          iterator& operator++() { pos_++; return *this; }
+          iterator operator++(int) { iterator tmp = *this; pos_++; return tmp; }
+          bool operator==(const iterator& other) const { return pos_ == other.pos_; }
+          bool operator!=(const iterator& other) const { return pos_ != other.pos_; }
+          /**
+           * \endcond
+           */
+
+        private:
+          const NeighborView* view_ = nullptr;
+          StagInt pos_ = 0;
+      };
+
+      /**
+       * Construct an empty neighborhood view.
+       */
+      NeighborView() = default;
+
+      /**
+       * Construct a view over the neighborhood of a vertex.
+       *
+       * @param v the vertex whose neighborhood is described by the view
+       * @param neighbors pointer to the first neighbor id of v
+       * @param weights pointer to the weight of the edge to the first neighbor of v
+       * @param size the number of neighbors of v
+       */
+      NeighborView(StagInt v, const StagInt* neighbors,
+                   const StagReal* weights, StagInt size)
+        : vertex_(v), neighbors_(neighbors), weights_(weights), size_(size) {}
+
+      /**
+       * The vertex whose neighborhood is described by this view.
+       */
+      StagInt vertex() const { return vertex_; }
+
+      /**
+       * The number of neighbors in the view.
+       */
+      StagInt size() const { return size_; }
+
+      /**
+       * Whether the vertex has no neighbors.
+       */
+      bool empty() const { return size_ == 0; }
+
+      /**
+       * The ids of the neighbors, ignoring the edge weights.
+       */
+      std::span<const StagInt> ids() const {
+        return {neighbors_, (size_t) size_};
+      }
+
+      /**
+       * The weights of the edges to each neighbor, in the same order as
+       * stag::NeighborView::ids.
+       */
+      std::span<const StagReal> weights() const {
+        return {weights_, (size_t) size_};
+      }
+
+      /**
+       * Return the i-th edge in the neighborhood.
+       */
+      edge operator[](StagInt i) const {
+        return {vertex_, neighbors_[i], weights_[i]};
+      }
+
+      /**
+       * \cond
+       */
+      iterator begin() const { return {this, 0}; }
+      iterator end() const { return {this, size_}; }
+      /**
+       * \endcond
+       */
+
+    private:
+      StagInt vertex_ = 0;
+      const StagInt* neighbors_ = nullptr;
+      const StagReal* weights_ = nullptr;
+      StagInt size_ = 0;
+  };
+
   /**
    * \brief An abstract class which defines methods for exploring the
    * local neighborhood of vertices in a graph.
@@ -86,6 +220,25 @@ namespace stag {
        */
       virtual std::vector<StagInt> neighbors_unweighted(StagInt v) = 0;
 
+      /**
+       * Given a vertex v, return a non-owning view of the neighborhood of v.
+       *
+       * Unlike stag::LocalGraph::neighbors, this method does not copy the
+       * neighborhood of v into a new vector. Subclasses which store the
+       * neighborhood of each vertex in memory should override this method to
+       * return a view directly into their internal storage.
+       *
+       * The default implementation calls stag::LocalGraph::neighbors and keeps
+       * the result in a buffer owned by this object, which is reused by the
+       * next call to this method.
+       * Therefore, the returned view is only guaranteed to be valid until the
+       * next call to a non-const method of this object.
+       *
+       * @param v an int representing some vertex in the graph
+       * @return a stag::NeighborView describing the neighborhood of v
+       */
+      virtual NeighborView neighbors_view(StagInt v);
+
       /**
        * Given a list of vertices, return the degrees of each vertex in the
        * list.
@@ -118,10 +271,227 @@ namespace stag {
        */
        virtual bool vertex_exists(StagInt v) = 0;
 
+      /**
+       * Hint that the neighborhoods of the given vertices will be queried
+       * soon.
+       *
+       * Local algorithms call this method with the vertices they are about
+       * to visit, so that graphs stored on disk can begin reading them in the
+       * background, rather than waiting for each vertex in turn.
+       * The hint does not change the result of any other method, and the
+       * vertices need not exist in the graph.
+       *
+       * The default implementation does nothing.
+       *
+       * @param vertices the vertices whose neighborhoods will be queried
+       */
+      virtual void prefetch(std::span<const StagInt> vertices);
+
       /**
        * Destructor for the LocalGraph object.
        */
       virtual ~LocalGraph() = default;
+
+    protected:
+      /**
+       * \cond
+       */
+      // Buffers backing the view returned by the default implementation of
+      // neighbors_view.
+      std::vector<StagInt> view_ids_buffer_;
+      std::vector<StagReal> view_weights_buffer_;
+      /**
+       * \endcond
+       */
+  };
+
+  /**
+   * \cond
+   * A sparse matrix which is computed from a graph when it is first needed.
+   *
+   * The matrix is computed at most once, even if it is first requested by
+   * several threads at the same time. Copying the object copies the matrix
+   * only if it has already been computed.
+   */
+  class LazySprsMat {
+    public:
+      LazySprsMat() = default;
+      LazySprsMat(const LazySprsMat& other);
+      LazySprsMat(LazySprsMat&& other) noexcept;
+      LazySprsMat& operator=(const LazySprsMat& other);
+      LazySprsMat& operator=(LazySprsMat&& other) noexcept;
+
+      /**
+       * Return the matrix, first calling initialise(matrix) to compute it if
+       * it has not been computed yet.
+       */
+      template <typename Initialiser>
+      const SprsMat* get(Initialiser initialise) const {
+        if (!initialised_.load(std::memory_order_acquire)) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (!initialised_.load(std::memory_order_relaxed)) {
+            initialise(matrix_);
+            initialised_.store(true, std::memory_order_release);
+          }
+        }
+        return &matrix_;
+      }
+
+      /**
+       * Discard the matrix, so that it is computed again when it is next
+       * requested. This must not be called at the same time as get().
+       */
+      void reset();
+
+      /**
+       * Whether the matrix has been computed.
+       */
+      bool initialised() const;
+
+      /**
+       * Discard the matrix if it has been computed, in order to free its
+       * memory. Any pointer previously returned by get() is invalidated.
+       */
+      void evict() const;
+
+      /**
+       * Record that the matrix was used at the given time.
+       */
+      void mark_used(StagUInt time) const;
+
+      /**
+       * The time at which the matrix was last used.
+       */
+      StagUInt last_used() const;
+
+      /**
+       * The number of bytes used to store the matrix, or 0 if the matrix has
+       * not been computed.
+       */
+      StagUInt memory_usage() const;
+
+    private:
+      mutable std::atomic<bool> initialised_ = false;
+      mutable std::atomic<StagUInt> last_used_ = 0;
+      mutable std::mutex mutex_;
+      mutable SprsMat matrix_;
+  };
+
+  /**
+   * A read-only memory mapping of a file.
+   *
+   * The pages of the file are read by the operating system when they are
+   * first accessed, and so opening a file takes constant time regardless of
+   * its size.
+   */
+  class MappedFile {
+    public:
+      MappedFile() = default;
+
+      /**
+       * Map the given file into memory.
+       *
+       * @throws std::runtime_error if the file cannot be opened or mapped
+       */
+      explicit MappedFile(const std::string& filename);
+
+      MappedFile(const MappedFile& other) = delete;
+      MappedFile& operator=(const MappedFile& other) = delete;
+      MappedFile(MappedFile&& other) noexcept;
+      MappedFile& operator=(MappedFile&& other) noexcept;
+      ~MappedFile();
+
+      /**
+       * A pointer to the first byte of the file.
+       */
+      const char* data() const;
+
+      /**
+       * The size of the file in bytes.
+       */
+      StagUInt size() const;
+
+      /**
+       * Ask the operating system to begin reading the given range of the
+       * file into memory, without waiting for it to be read.
+       *
+       * @param offset the first byte of the range
+       * @param length the number of bytes in the range
+       */
+      void prefetch(StagUInt offset, StagUInt length) const;
+
+    private:
+      void unmap_();
+
+      const char* data_ = nullptr;
+      StagUInt size_ = 0;
+  };
+  /**
+   * \endcond
+   */
+
+  /**
+   * \brief The memory used by a stag::Graph object, in bytes.
+   *
+   * The derived matrices are computed when they are first requested, and
+   * use no memory until then.
+   */
+  struct GraphMemoryUsage {
+    /**
+     * The adjacency matrix of the graph.
+     */
+    StagUInt adjacency;
+
+    /**
+     * The vectors of weighted and unweighted vertex degrees.
+     */
+    StagUInt degrees;
+
+    /**
+     * The Laplacian matrix of the graph.
+     */
+    StagUInt laplacian;
+
+    /**
+     * The signless Laplacian matrix of the graph.
+     */
+    StagUInt signless_laplacian;
+
+    /**
+     * The normalised Laplacian matrix of the graph.
+     */
+    StagUInt normalised_laplacian;
+
+    /**
+     * The normalised signless Laplacian matrix of the graph.
+     */
+    StagUInt normalised_signless_laplacian;
+
+    /**
+     * The degree matrix of the graph.
+     */
+    StagUInt degree_matrix;
+
+    /**
+     * The inverse degree matrix of the graph.
+     */
+    StagUInt inverse_degree_matrix;
+
+    /**
+     * The lazy random walk matrix of the graph.
+     */
+    StagUInt lazy_random_walk_matrix;
+
+    /**
+     * The memory used by all of the derived matrices, which may be freed by
+     * stag::Graph::clear_cache.
+     */
+    StagUInt cached() const;
+
+    /**
+     * The total memory used by the graph.
+     */
+    StagUInt total() const;
   };
 
   /**
@@ -135,6 +505,20 @@ namespace stag {
    *
    * This class supports graphs with positive edge weights. Self-loops are
    * permitted.
+   *
+   * \par Thread safety
+   * Any number of threads may query a graph at the same time, as long as no
+   * thread modifies it. This includes the const methods of the graph, and
+   * the methods of the stag::LocalGraph interface, and so one graph can be
+   * shared by many threads running, for example, stag::local_cluster or
+   * stag::conductance.
+   * The derived matrices, such as stag::Graph::laplacian, are computed when
+   * they are first requested, and each is computed only once even if it is
+   * first requested by several threads at the same time.
+   * The methods which modify the graph, such as stag::Graph::add_edge, must
+   * not be called while any other thread is using the graph.
+   * A graph in dynamic mode (see stag::Graph::set_dynamic) should be
+   * compacted with stag::Graph::compact before it is shared between threads.
    */
   class Graph : public LocalGraph {
     public:
@@ -224,7 +608,7 @@ namespace stag {
        *
        * @return a sparse Eigen matrix representing the graph Laplacian
        */
-      const SprsMat* laplacian();
+      const SprsMat* laplacian() const;
 
       /**
        * Return the normalised Laplacian matrix of the graph.
@@ -242,7 +626,7 @@ namespace stag {
        *
        * @return a sparse Eigen matrix representing the normalised Laplacian
        */
-      const SprsMat* normalised_laplacian();
+      const SprsMat* normalised_laplacian() const;
 
       /**
        * Return the signless Laplacian matrix of the graph.
@@ -260,7 +644,7 @@ namespace stag {
        *
        * @return a sparse Eigen matrix representing the signless graph Laplacian
        */
-      const SprsMat* signless_laplacian();
+      const SprsMat* signless_laplacian() const;
 
       /**
        * Return the normalised signless Laplacian matrix of the graph.
@@ -278,7 +662,7 @@ namespace stag {
        *
        * @return a sparse Eigen matrix representing the normalised Laplacian
        */
-      const SprsMat* normalised_signless_laplacian();
+      const SprsMat* normalised_signless_laplacian() const;
 
       /**
        * The degree matrix of the graph.
@@ -288,7 +672,7 @@ namespace stag {
        *
        * @return a sparse Eigen matrix
        */
-      const SprsMat* degree_matrix();
+      const SprsMat* degree_matrix() const;
 
       /**
        * The inverse degree matrix of the graph.
@@ -299,7 +683,7 @@ namespace stag {
        *
        * @return a sparse Eigen matrix
        */
-      const SprsMat* inverse_degree_matrix();
+      const SprsMat* inverse_degree_matrix() const;
 
       /**
        * The lazy random walk matrix of the graph.
@@ -315,7 +699,17 @@ namespace stag {
        *
        * @return a sparse Eigen matrix
        */
-      const SprsMat* lazy_random_walk_matrix();
+      const SprsMat* lazy_random_walk_matrix() const;
+
+      /**
+       * Return a vector containing the degree of every vertex in the graph.
+       *
+       * The degrees are computed when the graph is constructed or modified,
+       * and so this method takes constant time.
+       *
+       * @return a vector whose i-th entry is the degree of vertex i
+       */
+      const std::vector<StagReal>* degree_vector() const;
 
       /**
        * The total volume of the graph.
@@ -324,7 +718,7 @@ namespace stag {
        *
        * @return the graph's volume.
        */
-      StagReal total_volume();
+      StagReal total_volume() const;
 
       /**
        * The average degree of the graph.
@@ -333,7 +727,7 @@ namespace stag {
        *
        * @return the graph's average degree.
        */
-      StagReal average_degree();
+      StagReal average_degree() const;
 
       /**
        * The number of vertices in the graph.
@@ -374,6 +768,79 @@ namespace stag {
         */
        void remove_edge(StagInt i, StagInt j);
 
+       /**
+        * Add several edges to the graph.
+        *
+        * This is equivalent to calling stag::Graph::add_edge for each
+        * edge in turn, but the adjacency matrix of the graph is updated only
+        * once. Adding \f$k\f$ edges to a graph with \f$m\f$ edges takes
+        * time \f$O(m + k \log(k))\f$.
+        *
+        * @param edges the edges to add to the graph
+        * @throws std::invalid_argument if any of the vertex indices are negative
+        */
+       void add_edges(const std::vector<edge>& edges);
+
+       /**
+        * Remove several edges from the graph.
+        *
+        * This is equivalent to calling stag::Graph::remove_edge for each
+        * edge in turn, but the adjacency matrix of the graph is compressed
+        * only once.
+        * The weights of the given edges are ignored, and any edges which
+        * are not in the graph are skipped.
+        *
+        * @param edges the edges to remove from the graph
+        */
+       void remove_edges(const std::vector<edge>& edges);
+
+       /**
+        * Enable or disable dynamic mode, for graphs whose edges are removed
+        * frequently.
+        *
+        * By default, removing an edge compresses the adjacency matrix, which
+        * takes time proportional to the number of edges in the graph.
+        * In dynamic mode, a removed edge is instead marked with a weight of
+        * zero (a 'tombstone'), and the degrees of its endpoints and the
+        * number of edges in the graph are updated directly. Removing an edge
+        * then takes time \f$O(\log(d))\f$, where \f$d\f$ is the degree of its
+        * endpoints. Adding an edge which is already in the graph, or which
+        * has been removed since the graph was last compacted, takes the same
+        * time.
+        *
+        * The tombstones are removed in a single pass over the adjacency
+        * matrix once they make up half of its entries, or when
+        * stag::Graph::compact is called.
+        * The methods of the stag::LocalGraph interface skip the tombstones,
+        * but the adjacency matrix and the matrices derived from it may
+        * contain explicit zero entries until the graph is compacted.
+        *
+        * Disabling dynamic mode compacts the graph.
+        *
+        * @param dynamic whether to enable dynamic mode
+        */
+       void set_dynamic(bool dynamic);
+
+       /**
+        * Whether the graph is in dynamic mode.
+        */
+       bool is_dynamic() const;
+
+       /**
+        * Remove the tombstones left by removing edges in dynamic mode from
+        * the adjacency matrix.
+        *
+        * This takes time proportional to the number of edges in the graph,
+        * and has no effect if there are no tombstones.
+        */
+       void compact();
+
+       /**
+        * The number of entries of the adjacency matrix which are tombstones
+        * of removed edges.
+        */
+       StagInt number_of_tombstones() const;
+
        /**
         * Returns a boolean indicating whether this graph contains self loops.
         */
@@ -410,11 +877,59 @@ namespace stag {
         */
        Graph disjoint_union(Graph& other);
 
+       /**
+        * Report the memory used by the adjacency matrix, the vertex degrees
+        * and each of the derived matrices of the graph.
+        *
+        * @return a stag::GraphMemoryUsage object
+        */
+       GraphMemoryUsage memory_usage() const;
+
+       /**
+        * Set the maximum memory to be used by the derived matrices of the
+        * graph, such as the Laplacian matrix.
+        *
+        * Whenever a derived matrix is computed and the memory used by the
+        * derived matrices exceeds the budget, the least recently used
+        * matrices are discarded until the budget is met. A discarded matrix
+        * is computed again if it is requested later. The matrix which was
+        * most recently requested is never discarded, and so the budget may
+        * be exceeded by a single matrix.
+        *
+        * By default, the budget is unlimited and no matrix is ever discarded.
+        *
+        * \note
+        * When a budget is set, the pointer returned by a matrix accessor such
+        * as stag::Graph::laplacian is only valid until another derived matrix
+        * is requested. Therefore, a graph with a budget should not be shared
+        * between threads which request derived matrices.
+        *
+        * @param bytes the memory budget for derived matrices, in bytes
+        */
+       void set_cache_budget(StagUInt bytes);
+
+       /**
+        * The maximum memory to be used by the derived matrices of the graph.
+        *
+        * See stag::Graph::set_cache_budget.
+        */
+       StagUInt cache_budget() const;
+
+       /**
+        * Discard every derived matrix of the graph to free its memory.
+        *
+        * The matrices will be computed again if they are requested later.
+        * Any pointer previously returned by a matrix accessor such as
+        * stag::Graph::laplacian is invalidated.
+        */
+       void clear_cache();
+
        // Override the abstract methods in the LocalGraph base class.
        StagReal degree(StagInt v) override;
        StagInt degree_unweighted(StagInt v) override;
        std::vector<edge> neighbors(StagInt v) override;
        std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+       NeighborView neighbors_view(StagInt v) override;
        std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
        std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
        bool vertex_exists(StagInt v) override;
@@ -422,46 +937,102 @@ namespace stag {
 
     private:
       /**
-       * Initialise the laplacian matrix of the graph if it has not been
-       * initialised yet.
+       * Compute the Laplacian matrix of the graph.
+       */
+      void initialise_laplacian_(SprsMat& laplacian) const;
+
+      /**
+       * Compute the signless Laplacian matrix of the graph.
+       */
+      void initialise_signless_laplacian_(SprsMat& signless_laplacian) const;
+
+      /**
+       * Compute the normalised Laplacian matrix of the graph.
+       */
+      void initialise_normalised_laplacian_(SprsMat& normalised_laplacian) const;
+
+      /**
+       * Compute the normalised signless Laplacian matrix of the graph.
+       */
+      void initialise_normalised_signless_laplacian_(SprsMat& normalised_signless_laplacian) const;
+
+      /**
+       * Compute the degree matrix of the graph.
+       */
+      void initialise_degree_matrix_(SprsMat& degree_matrix) const;
+
+      /**
+       * Compute the inverse degree matrix of the graph.
+       */
+      void initialise_inverse_degree_matrix_(SprsMat& inverse_degree_matrix) const;
+
+      /**
+       * Compute the lazy random walk matrix of the graph.
+       */
+      void initialise_lazy_random_walk_matrix_(SprsMat& lazy_random_walk_matrix) const;
+
+      /**
+       * Discard every derived matrix of the graph, so that they are computed
+       * again when they are next requested.
+       *
+       * This should be called whenever the adjacency matrix is modified.
+       */
+      void reset_initialised_flags_();
+
+      /**
+       * A pointer to one of the private methods which computes a derived
+       * matrix.
        */
-      void initialise_laplacian_();
+      using MatrixInitialiser = void (Graph::*)(SprsMat&) const;
 
       /**
-       * Initialise the signless Laplacian matrix of the graph if it has not been
-       * initialised yet.
+       * Return the given derived matrix, computing it if necessary, and
+       * discarding other derived matrices if the cache budget is exceeded.
        */
-      void initialise_signless_laplacian_();
+      const SprsMat* cached_matrix_(const LazySprsMat& matrix,
+                                    MatrixInitialiser initialise) const;
 
       /**
-       * Initialise the normalised Laplacian matrix of the graph is it has not
-       * been initialised yet.
+       * Discard the least recently used derived matrices, other than the
+       * given one, until the memory used by the derived matrices is within
+       * the cache budget.
        */
-      void initialise_normalised_laplacian_();
+      void enforce_cache_budget_(const LazySprsMat* keep) const;
 
       /**
-       * Initialise the signless Laplacian matrix of the graph if it has not been
-       * initialised yet.
+       * Compute the degree of every vertex, the total volume, and the number
+       * of edges and self-loops from the adjacency matrix.
+       *
+       * This should be called whenever the adjacency matrix is modified.
        */
-      void initialise_normalised_signless_laplacian_();
+      void update_degrees_();
 
       /**
-       * Initialise the degree matrix of the graph if it has not been
-       * initialised yet.
+       * Find the entry in the given row and column of the adjacency matrix.
+       *
+       * @return the position of the entry in the value array of the adjacency
+       *         matrix, or -1 if the entry is not stored in the matrix
        */
-      void initialise_degree_matrix_();
+      StagInt find_entry_(StagInt row, StagInt col) const;
 
       /**
-       * Initialise the inverse degree matrix of the graph if it has not been
-       * initialised yet.
+       * Update the weight of the edge between i and j without changing the
+       * structure of the adjacency matrix, and update the vertex degrees and
+       * the numbers of edges, self-loops and tombstones to match.
+       *
+       * If accumulate is true, w is added to the weight of the edge.
+       * Otherwise, the weight of the edge is set to w.
+       *
+       * @return false if the edge is not stored in the adjacency matrix, in
+       *         which case nothing is changed
        */
-      void initialise_inverse_degree_matrix_();
+      bool update_edge_in_place_(StagInt i, StagInt j, StagReal w, bool accumulate);
 
       /**
-       * Initialise the lazy random walk matrix of the graph if it has not been
-       * initialised yet.
+       * Compact the graph if the tombstones make up at least half of the
+       * entries of the adjacency matrix.
        */
-      void initialise_lazy_random_walk_matrix_();
+      void compact_if_needed_();
 
       /**
        * Check that the graph conforms to all assumptions that are currently
@@ -499,59 +1070,666 @@ namespace stag {
       // Whether the graph has self loops
       bool has_self_loops_;
 
-      // The laplacian matrix of the graph. The lap_init_ variable is used to
-      // indicate whether the matrix has been initialised yet.
-      bool lap_init_;
-      SprsMat laplacian_matrix_;
-
-      // The signless Laplacian matrix of the graph.
-      bool signless_lap_init_;
-      SprsMat signless_laplacian_matrix_;
-
-      // The normalised Laplacian matrix of the graph. The norm_lap_init_
-      // variable is used to indicate whether the matrix has been initialised
-      // yet.
-      bool norm_lap_init_;
-      SprsMat normalised_laplacian_matrix_;
-
-      // The normalised signless Laplacian matrix of the graph.
-      bool signless_norm_lap_init_;
-      SprsMat normalised_signless_laplacian_matrix_;
-
-      // The degree matrix of the graph. The deg_init_ variable is used to
-      // indicate whether the matrix has been initialised yet.
-      bool deg_init_;
-      SprsMat degree_matrix_;
-
-      // The inverse degree matrix of the graph. The inv_deg_init_ variable is used to
-      // indicate whether the matrix has been initialised yet.
-      bool inv_deg_init_;
-      SprsMat inverse_degree_matrix_;
-
-      // The lazy random walk matrix of the graph. The lazy_rand_walk_init_ variable
-      // is used to indicate whether the matrix has been initialised yet.
-      bool lazy_rand_walk_init_;
-      SprsMat lazy_random_walk_matrix_;
+      // The weighted and unweighted degrees of every vertex, the total volume,
+      // and the number of edges and self-loops in the graph. Unlike the
+      // matrices below, these are updated every time the adjacency matrix is
+      // modified, so that querying them takes constant time.
+      std::vector<StagReal> degrees_;
+      std::vector<StagInt> unweighted_degrees_;
+      StagReal total_volume_;
+      StagInt number_of_edges_;
+      StagInt number_of_self_loops_;
+
+      // Whether the graph is in dynamic mode, and the number of entries of
+      // the adjacency matrix which are zero because their edge was removed.
+      bool dynamic_ = false;
+      StagInt number_of_tombstones_;
+
+      // The matrices derived from the adjacency matrix. Each is computed when
+      // it is first requested.
+      LazySprsMat laplacian_matrix_;
+      LazySprsMat signless_laplacian_matrix_;
+      LazySprsMat normalised_laplacian_matrix_;
+      LazySprsMat normalised_signless_laplacian_matrix_;
+      LazySprsMat degree_matrix_;
+      LazySprsMat inverse_degree_matrix_;
+      LazySprsMat lazy_random_walk_matrix_;
+
+      // The maximum memory in bytes to be used by the derived matrices.
+      StagUInt cache_budget_ = std::numeric_limits<StagUInt>::max();
   };
 
 
   /**
-   * \brief A local graph backed by an adjacency list file on disk.
+   * \brief A helper for constructing a stag::Graph from a stream of edges.
+   *
+   * Adding edges one at a time to a stag::Graph with
+   * stag::Graph::add_edge updates the sparse adjacency matrix on every call.
+   * The GraphBuilder instead buffers the edges in memory, and constructs the
+   * adjacency matrix only once when stag::GraphBuilder::build is called.
+   *
+   * \code{.cpp}
+   *     #include <stag/graph.h>
+   *
+   *     int main() {
+   *       stag::GraphBuilder builder;
+   *       builder.add_edge(0, 1, 1);
+   *       builder.add_edge(1, 2, 0.5);
+   *       builder.add_edge(2, 0, 2);
+   *
+   *       stag::Graph myGraph = builder.build();
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   *
+   * As with stag::Graph::add_edge, adding an edge which is already present
+   * increases the weight of the existing edge.
+   */
+  class GraphBuilder {
+  public:
+    /**
+     * Create a builder for an empty graph.
+     */
+    GraphBuilder();
+
+    /**
+     * Create a builder for a graph with at least the given number of vertices.
+     *
+     * The number of vertices in the graph will be increased if any edges are
+     * added with larger vertex indices.
+     *
+     * @param number_of_vertices the minimum number of vertices in the
+     *                           constructed graph
+     */
+    explicit GraphBuilder(StagInt number_of_vertices);
+
+    /**
+     * Add an edge from node i to node j with weight w.
+     *
+     * @param i
+     * @param j
+     * @param w
+     * @throws std::invalid_argument if either vertex index is negative
+     */
+    void add_edge(StagInt i, StagInt j, StagReal w);
+
+    /**
+     * Add several edges to the graph being constructed.
+     *
+     * @param edges the edges to add
+     * @throws std::invalid_argument if any of the vertex indices are negative
+     */
+    void add_edges(const std::vector<edge>& edges);
+
+    /**
+     * Reserve memory for the given number of edges to be added.
+     */
+    void reserve(StagInt number_of_edges);
+
+    /**
+     * The number of vertices in the graph which will be constructed.
+     */
+    StagInt number_of_vertices() const;
+
+    /**
+     * Discard all of the edges added to the builder so far.
+     */
+    void clear();
+
+    /**
+     * Construct the graph containing every edge added so far.
+     *
+     * The edges are not removed from the builder, and so more edges can be
+     * added and another graph constructed later.
+     *
+     * @return a new stag::Graph object
+     */
+    Graph build() const;
+
+  private:
+    // The number of vertices in the graph to be constructed.
+    StagInt number_of_vertices_;
+
+    // The non-zero entries of the adjacency matrix to be constructed. Every
+    // edge is stored in both directions.
+    std::vector<EdgeTriplet> non_zero_entries_;
+  };
+
+  /**
+   * \brief A graph in which every edge has weight 1.
+   *
+   * Many graphs, such as those generated by stag::sbm and stag::erdos_renyi,
+   * have no edge weights. The stag::Graph class stores a weight for every
+   * non-zero entry in the adjacency matrix regardless, which the
+   * stag::UnweightedGraph class avoids by storing only the structure of the
+   * graph. This reduces the memory used by the graph and the amount of data
+   * read by every neighbor scan and matrix-vector product.
+   *
+   * An unweighted graph implements the stag::LocalGraph interface, and can
+   * also be passed to the spectral methods stag::compute_eigensystem,
+   * stag::spectral_cluster and stag::cheeger_cut, and to
+   * stag::GraphMatrixOp.
+   *
+   * \code{.cpp}
+   *     #include <stag/graph.h>
+   *     #include <stag/random.h>
+   *     #include <stag/cluster.h>
+   *
+   *     int main() {
+   *       stag::Graph myGraph = stag::sbm(1000, 2, 0.1, 0.01);
+   *       stag::UnweightedGraph unweightedGraph(myGraph);
+   *
+   *       std::vector<StagInt> clusters = stag::spectral_cluster(&unweightedGraph, 2);
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   *
+   * A self-loop in an unweighted graph is treated as an edge of weight 1, and
+   * so contributes 2 to the degree of its vertex.
+   */
+  class UnweightedGraph : public LocalGraph {
+  public:
+    /**
+     * Construct an unweighted graph with the same edges as the given graph.
+     *
+     * The weights of the edges in the given graph are ignored, and every
+     * edge in the constructed graph has weight 1.
+     *
+     * @param graph the graph whose structure to copy
+     */
+    explicit UnweightedGraph(const Graph& graph);
+
+    /**
+     * Construct a stag::Graph object with the same edges as this graph, each
+     * with weight 1.
+     *
+     * @return a new stag::Graph object
+     */
+    Graph to_graph() const;
+
+    /**
+     * The number of vertices in the graph.
+     */
+    StagInt number_of_vertices() const;
+
+    /**
+     * The number of edges in the graph.
+     */
+    StagInt number_of_edges() const;
+
+    /**
+     * The volume of the graph, which is the sum of the degrees of all
+     * vertices.
+     */
+    StagReal total_volume() const;
+
+    /**
+     * Whether the graph contains at least one self-loop.
+     */
+    bool has_self_loops() const;
+
+    /**
+     * The compressed sparse column starts of the adjacency matrix of the
+     * graph. The neighbors of vertex \f$v\f$ are stored in positions
+     * (*outer_starts())[v] to (*outer_starts())[v + 1] - 1 of the inner
+     * indices.
+     */
+    const std::vector<StagInt>* outer_starts() const;
+
+    /**
+     * The compressed sparse row indices of the adjacency matrix of the
+     * graph. The neighbors of each vertex are sorted.
+     */
+    const std::vector<StagInt>* inner_indices() const;
+
+    /**
+     * The number of bytes used to store the edges of the graph.
+     */
+    StagUInt memory_usage() const;
+
+    // Override the abstract methods in the LocalGraph base class.
+    StagReal degree(StagInt v) override;
+    StagInt degree_unweighted(StagInt v) override;
+    std::vector<edge> neighbors(StagInt v) override;
+    std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+    NeighborView neighbors_view(StagInt v) override;
+    std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
+    std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
+    bool vertex_exists(StagInt v) override;
+    ~UnweightedGraph() override = default;
+
+  private:
+    /**
+     * Check the validity of a method argument which is supposed to refer
+     * to a vertex in the graph.
+     *
+     * @throws std::invalid_argument if the check does not pass
+     */
+    void check_vertex_argument(StagInt v) const;
+
+    // The number of vertices, edges, and self-loops in the graph.
+    StagInt number_of_vertices_;
+    StagInt number_of_edges_;
+    StagInt number_of_self_loops_;
+
+    // The compressed sparse representation of the adjacency matrix, without
+    // the values.
+    std::vector<StagInt> outer_starts_;
+    std::vector<StagInt> inner_indices_;
+
+    // A vector of ones at least as long as the largest neighborhood, used as
+    // the weights of every stag::NeighborView.
+    std::vector<StagReal> unit_weights_;
+  };
+
+  /**
+   * \brief A view of the subgraph induced by a set of vertices of another
+   * graph.
+   *
+   * The view stores only the set of vertices in the subgraph. The edges of
+   * the subgraph are found when they are queried, by filtering the neighbors
+   * of each vertex in the parent graph, and so constructing a view takes
+   * time proportional to the number of vertices in the subgraph, regardless
+   * of the size of the parent graph.
+   *
+   * The vertices of the view keep their ids from the parent graph. This
+   * means that the results of local algorithms on the view, such as
+   * stag::connected_component or stag::sweep_set_conductance, can be used
+   * directly with the parent graph.
+   *
+   * \code{.cpp}
+   *     #include <stag/graph.h>
+   *     #include <stag/cluster.h>
+   *
+   *     int main() {
+   *       stag::Graph myGraph = stag::barbell_graph(10);
+   *       std::vector<StagInt> cluster = stag::local_cluster(&myGraph, 0, 50);
+   *
+   *       // Find the connected component of vertex 0 within the cluster
+   *       stag::SubgraphView clusterGraph(&myGraph, cluster);
+   *       std::vector<StagInt> component = stag::connected_component(&clusterGraph, 0);
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   *
+   * The view refers to the parent graph, and so the parent graph must not be
+   * destroyed while the view is in use.
+   */
+  class SubgraphView : public LocalGraph {
+  public:
+    /**
+     * Construct a view of the subgraph of the parent graph induced by the
+     * given vertices.
+     *
+     * Any duplicate vertices are ignored.
+     *
+     * @param parent the graph containing the subgraph
+     * @param vertices the vertices in the subgraph
+     * @throws std::invalid_argument if any of the vertices are not in the
+     *         parent graph
+     */
+    SubgraphView(LocalGraph* parent, const std::vector<StagInt>& vertices);
+
+    /**
+     * Construct a stag::Graph object containing the edges of the subgraph.
+     *
+     * As with stag::Graph::subgraph, the vertices are relabelled in the
+     * constructed graph. The vertex stag::SubgraphView::vertices()[i] is given
+     * the label i.
+     *
+     * @return a new stag::Graph object
+     */
+    Graph materialise();
+
+    /**
+     * The vertices in the subgraph, in the order in which they were given to
+     * the constructor, with duplicates removed.
+     */
+    const std::vector<StagInt>& vertices() const;
+
+    /**
+     * The number of vertices in the subgraph.
+     */
+    StagInt number_of_vertices() const;
+
+    /**
+     * Whether the given vertex of the parent graph is in the subgraph.
+     */
+    bool contains(StagInt v) const;
+
+    // Override the abstract methods in the LocalGraph base class.
+    StagReal degree(StagInt v) override;
+    StagInt degree_unweighted(StagInt v) override;
+    std::vector<edge> neighbors(StagInt v) override;
+    std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+    NeighborView neighbors_view(StagInt v) override;
+    std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
+    std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
+    bool vertex_exists(StagInt v) override;
+    void prefetch(std::span<const StagInt> vertices) override;
+    ~SubgraphView() override = default;
+
+  private:
+    /**
+     * Check that the given vertex is in the subgraph.
+     *
+     * @throws std::invalid_argument if the check does not pass
+     */
+    void check_vertex_argument(StagInt v) const;
+
+    // The graph containing the subgraph.
+    LocalGraph* parent_;
+
+    // The vertices of the subgraph in their original order.
+    std::vector<StagInt> vertices_;
+
+    // The vertices of the subgraph in sorted order, used to check whether a
+    // vertex is in the subgraph with binary search.
+    std::vector<StagInt> sorted_vertices_;
+  };
+
+  /**
+   * \brief Counters describing the use of a neighborhood cache, such as the
+   * cache of a stag::AdjacencyListLocalGraph.
+   */
+  struct NeighborhoodCacheStats {
+    /**
+     * The number of queries answered from the cache.
+     */
+    StagUInt hits;
+
+    /**
+     * The number of queries for which the neighborhood was read from disk.
+     */
+    StagUInt misses;
+
+    /**
+     * The number of neighborhoods removed from the cache to keep its memory
+     * usage within the budget.
+     */
+    StagUInt evictions;
+
+    /**
+     * The number of vertices whose neighborhoods are in the cache.
+     */
+    StagUInt cached_vertices;
+
+    /**
+     * The approximate number of bytes used by the neighborhoods in the cache.
+     */
+    StagUInt memory_usage;
+  };
+
+  /**
+   * \cond
+   * A least-recently-used cache of vertex neighborhoods, with a limit on the
+   * number of bytes used.
+   *
+   * The neighbor ids and weights of every cached vertex are stored in two
+   * shared arrays. The space used by evicted neighborhoods is reclaimed once
+   * it is larger than the space used by the cached neighborhoods, and so the
+   * arrays use at most twice the budget.
+   *
+   * A view returned by lookup() or insert() is valid until the next call to a
+   * non-const method of the cache.
+   */
+  class NeighborhoodCache {
+    public:
+      NeighborhoodCache() = default;
+
+      /**
+       * If the neighborhood of v is in the cache, mark it as the most
+       * recently used and set view to point to it.
+       *
+       * @return whether the neighborhood of v is in the cache
+       */
+      bool lookup(StagInt v, NeighborView* view);
+
+      /**
+       * Whether the neighborhood of v is in the cache. Unlike lookup, this
+       * does not change the order of eviction or the counters.
+       */
+      bool contains(StagInt v) const;
+
+      /**
+       * Add the neighborhood of v to the cache, evicting the least recently
+       * used neighborhoods if needed. The new neighborhood is always kept,
+       * even if it is larger than the budget. If the neighborhood of v is
+       * already in the cache, it is marked as the most recently used and
+       * left unchanged.
+       *
+       * @return a view of the cached neighborhood
+       */
+      NeighborView insert(StagInt v, const std::vector<edge>& edges);
+
+      /**
+       * Set the maximum number of bytes to be used by the cache, evicting
+       * neighborhoods if needed.
+       */
+      void set_budget(StagUInt bytes);
+
+      /**
+       * The maximum number of bytes to be used by the cache.
+       */
+      StagUInt budget() const;
+
+      /**
+       * Remove every neighborhood from the cache. The counters are not reset.
+       */
+      void clear();
+
+      /**
+       * The counters describing the use of the cache.
+       */
+      NeighborhoodCacheStats stats() const;
+
+    private:
+      // An entry of the cache, which is a node in a doubly-linked list in
+      // order of use.
+      struct Slot {
+        StagInt vertex;
+        StagInt offset;
+        StagInt size;
+        StagInt prev;
+        StagInt next;
+      };
+
+      StagUInt entry_bytes_(StagInt size) const;
+      void unlink_(StagInt slot);
+      void push_front_(StagInt slot);
+      void evict_(StagInt slot);
+      void compact_();
+
+      // The neighborhoods of the cached vertices.
+      std::vector<StagInt> ids_;
+      std::vector<StagReal> weights_;
+      StagUInt live_entries_ = 0;
+      StagUInt dead_entries_ = 0;
+
+      // The cache entries, from most recently used (head_) to least recently
+      // used (tail_), and the slot of each cached vertex.
+      std::vector<Slot> slots_;
+      std::vector<StagInt> free_slots_;
+      std::unordered_map<StagInt, StagInt> slot_of_vertex_;
+      StagInt head_ = -1;
+      StagInt tail_ = -1;
+
+      StagUInt budget_ = std::numeric_limits<StagUInt>::max();
+      StagUInt memory_usage_ = 0;
+      StagUInt hits_ = 0;
+      StagUInt misses_ = 0;
+      StagUInt evictions_ = 0;
+  };
+
+  /**
+   * An adjacency list file mapped into memory, together with an index of the
+   * position of the content line of each node.
+   *
+   * The object is not modified after it is constructed, and so its const
+   * methods may be called from several threads at once.
+   */
+  class AdjacencyListFile {
+    public:
+      /**
+       * Map the adjacency list file into memory, and load or build its index.
+       *
+       * @throws std::runtime_error if the file cannot be opened, or its node
+       *         IDs are not sorted
+       */
+      explicit AdjacencyListFile(const std::string& filename);
+
+      /**
+       * Save the index to the file `<filename>.idx`, unless it was loaded
+       * from that file.
+       *
+       * @throws std::runtime_error if the index file cannot be written
+       */
+      void save_index() const;
+
+      /**
+       * Whether the index was loaded from a saved index file.
+       */
+      bool index_loaded() const;
+
+      /**
+       * Find the position of the content line of the given vertex in the
+       * adjacencylist file.
+       *
+       * @param v the vertex to search for
+       * @return the offset of the content line in the file, or -1 if the
+       *         vertex is not in the file
+       * @throws std::runtime_error if a saved index file is corrupted
+       */
+      StagInt find_vertex(StagInt v) const;
+
+      /**
+       * Find the position of the content line of the given vertex, starting
+       * the search of the index from the given position.
+       *
+       * The position is updated to the position of v in the index. When
+       * looking up vertices in increasing order, passing the same position
+       * to every call searches the index in a single forward sweep.
+       *
+       * @param v the vertex to search for
+       * @param position the position in the index to search from
+       * @return the offset of the content line in the file, or -1 if the
+       *         vertex is not in the file
+       * @throws std::runtime_error if a saved index file is corrupted
+       */
+      StagInt find_vertex(StagInt v, StagInt* position) const;
+
+      /**
+       * Parse the neighborhood of the given vertex from the file.
+       *
+       * @throws std::runtime_error if the vertex is not in the file
+       */
+      std::vector<edge> read_neighborhood(StagInt v) const;
+
+      /**
+       * Parse the content line beginning at the given offset of the file.
+       *
+       * @throws std::runtime_error if the offset is outside of the file
+       */
+      std::vector<edge> read_content_line(StagInt offset) const;
+
+      /**
+       * Ask the operating system to begin reading the content lines of the
+       * given vertices. Vertices which are not in the file are ignored.
+       */
+      void prefetch(std::span<const StagInt> vertices) const;
+
+    private:
+      /**
+       * Read the whole adjacency list file, and record the position of the
+       * content line of each node.
+       *
+       * @throws std::runtime_error if the node IDs are not sorted
+       */
+      void build_index_();
+
+      /**
+       * Load the index from the file `<filename>.idx`, if it exists and
+       * matches the adjacency list file.
+       *
+       * @return whether the index was loaded
+       */
+      bool load_index_();
+
+      /**
+       * The offset of the content line of the i-th node in the index.
+       *
+       * @throws std::runtime_error if the entry is not consistent with the
+       *         rest of the index and the adjacency list file
+       */
+      StagInt index_offset_(StagInt i) const;
+
+      // The adjacencylist file, mapped into memory.
+      std::string filename_;
+      MappedFile file_;
+
+      // The index of the file. The content line of node index_ids_[i] begins
+      // at offset index_offsets_[i] of the file. If the node IDs in the file
+      // are 0, 1, ..., n - 1, then index_ids_ is nullptr and the content line
+      // of node v begins at offset index_offsets_[v].
+      // The arrays point either into the mapped index file, or into the
+      // vectors below if the index was built when this object was constructed.
+      const StagInt* index_ids_ = nullptr;
+      const StagInt* index_offsets_ = nullptr;
+      StagInt index_size_ = 0;
+      MappedFile index_file_;
+      std::vector<StagInt> index_id_storage_;
+      std::vector<StagInt> index_offset_storage_;
+  };
+  /**
+   * \endcond
+   */
+
+  /**
+   * \brief A local graph backed by an adjacency list file on disk.
    *
    * The graph is loaded into memory in a local way only. That is, an adjacency
    * list data structure is constructed in memory as node neighbours are queried.
    * If a node is not found in the cached adjacency list, then the neighbours of
-   * the node are queried from the adjacency list on disk.
+   * the node are read from the adjacency list on disk.
    * This allows for local algorithms to be executed on very large graphs stored
    * on disk without loading the whole graph into memory.
    *
+   * The neighbourhoods which have been read are kept in a cache. By default,
+   * the cache has no size limit, and so a long-running process may
+   * eventually read the whole graph into memory. The memory used by the
+   * cache can be limited with stag::AdjacencyListLocalGraph::set_cache_budget,
+   * in which case the least recently used neighbourhoods are discarded.
+   *
+   * The adjacency list file is mapped into memory, and the operating system
+   * reads each part of the file from disk when it is first accessed.
+   * The object uses an index of the position of each node's content line, so
+   * that querying the neighbours of a node takes a single look-up in the
+   * index, and parsing one line of the file. The index uses 8 bytes for each
+   * node in the graph, or 16 bytes if the node IDs in the file are not
+   * \f$0, 1, \ldots, n - 1\f$.
+   *
+   * When the object is constructed, the index is loaded from the file
+   * `<filename>.idx` if it exists and was created from the current version
+   * of the adjacency list file. The index file is mapped into memory, and so
+   * loading it takes constant time.
+   * Otherwise, the adjacency list file is read once to build the index.
+   * The index file can be created with
+   * stag::AdjacencyListLocalGraph::save_index or the `stag_adjindex`
+   * [command line tool](@ref stag-tools).
+   *
    * See [Graph File Formats](@ref file-formats) for more information
    * about the adjacency list file format.
    *
+   * An AdjacencyListLocalGraph object must not be used by several threads at
+   * once. To run local algorithms from several threads against the same
+   * adjacency list file, use stag::ConcurrentAdjacencyListLocalGraph.
+   *
    * \note
    * It is important that the adjacency list on disk is stored with sorted
-   * node indices. This allows us to query the neighbours of a given node in
-   * \f$O(log(n))\f$ time using binary search.
+   * node indices.
    *
    */
   class AdjacencyListLocalGraph : public LocalGraph {
@@ -563,58 +1741,416 @@ namespace stag {
      * use by this object.
      *
      * @param filename the name of the adjacencylist file which defines the graph
+     * @throws std::runtime_error if the file cannot be opened, or its node
+     *         IDs are not sorted
      */
     AdjacencyListLocalGraph(const std::string& filename);
 
+    /**
+     * Save the index of the adjacency list file to the file `<filename>.idx`,
+     * so that it can be loaded by any stag::AdjacencyListLocalGraph object
+     * constructed later for the same file.
+     *
+     * The index records the size and modification time of the adjacency list
+     * file, and it is ignored if the adjacency list file is changed.
+     *
+     * @throws std::runtime_error if the index file cannot be written
+     */
+    void save_index() const;
+
+    /**
+     * Whether the index was loaded from a saved index file, rather than
+     * being built by reading the adjacency list file.
+     */
+    bool index_loaded() const;
+
+    /**
+     * Set the maximum number of bytes used to cache the neighbourhoods of
+     * the vertices which have been queried.
+     *
+     * When the cache is full, the least recently used neighbourhoods are
+     * discarded, and are read from the file again if they are queried later.
+     * The most recently queried neighbourhood is always kept.
+     * Each cached neighbourhood uses 16 bytes for every neighbour, and a
+     * few dozen bytes of book-keeping. The space used by discarded
+     * neighbourhoods is reclaimed in batches, and so the cache may use up to
+     * twice the budget.
+     *
+     * @param bytes the maximum number of bytes used by the cache
+     */
+    void set_cache_budget(StagUInt bytes);
+
+    /**
+     * The maximum number of bytes used to cache neighbourhoods. By default,
+     * this is unlimited.
+     */
+    StagUInt cache_budget() const;
+
+    /**
+     * The hit, miss and eviction counters of the neighbourhood cache.
+     */
+    NeighborhoodCacheStats cache_stats() const;
+
+    /**
+     * Discard every cached neighbourhood.
+     */
+    void clear_cache();
+
+    // Override the abstract methods in the LocalGraph base class.
+    StagReal degree(StagInt v) override;
+    StagInt degree_unweighted(StagInt v) override;
+    std::vector<edge> neighbors(StagInt v) override;
+    std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+    NeighborView neighbors_view(StagInt v) override;
+    std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
+    std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
+    bool vertex_exists(StagInt v) override;
+    void prefetch(std::span<const StagInt> vertices) override;
+    ~AdjacencyListLocalGraph() override = default;
+
+  private:
+    // The adjacencylist file backing this graph, mapped into memory. The
+    // implementation makes random access to this file to read the vertex
+    // adjacency information.
+    AdjacencyListFile file_;
+
+    /**
+     * Return the cached neighborhood of the vertex v, reading it from disk if
+     * it is not in the cache.
+     *
+     * @param v the vertex to query
+     * @return a view of the cached neighborhood of v, which is valid until
+     *         the next neighborhood is loaded
+     * @throws std::runtime_error if the vertex is not in the file
+     */
+    NeighborView load_neighborhood(StagInt v);
+
+    /**
+     * Return the cached neighborhood of the vertex v, starting the search of
+     * the index from the given position if it is not in the cache.
+     *
+     * See stag::AdjacencyListFile::find_vertex.
+     */
+    NeighborView load_neighborhood(StagInt v, StagInt* position);
+
+    // The neighborhoods of the vertices queried so far.
+    NeighborhoodCache cache_;
+  };
+
+  /**
+   * \brief A local graph backed by an adjacency list file on disk, which may
+   * be used by several threads at once.
+   *
+   * This class reads the adjacency list file in the same way as
+   * stag::AdjacencyListLocalGraph: the file is mapped into memory and every
+   * thread reads the content lines it needs directly from the mapping, using
+   * the same saved or constructed index.
+   * The neighbourhoods which have been read are kept in a cache which is
+   * split into shards, each protected by its own lock, so that threads
+   * querying different vertices rarely wait for each other.
+   *
+   * This allows a local algorithm such as stag::local_cluster to be run from
+   * many seed vertices in parallel, sharing one disk-resident graph and one
+   * cache.
+   *
+   * \code{.cpp}
+   *     #include <thread>
+   *     #include <stag/graph.h>
+   *     #include <stag/cluster.h>
+   *
+   *     int main() {
+   *       stag::ConcurrentAdjacencyListLocalGraph graph("graph.adjacencylist");
+   *       std::vector<StagInt> seeds = {0, 1000, 2000, 3000};
+   *       std::vector<std::vector<StagInt>> clusters(seeds.size());
+   *
+   *       std::vector<std::thread> threads;
+   *       for (StagUInt i = 0; i < seeds.size(); i++) {
+   *         threads.emplace_back([&, i]() {
+   *           clusters[i] = stag::local_cluster(&graph, seeds[i], 100);
+   *         });
+   *       }
+   *       for (std::thread& t : threads) t.join();
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   *
+   * Every method may be called from several threads at once, except for the
+   * methods which change the cache budget or clear the cache.
+   * A stag::NeighborView returned by neighbors_view is a copy of the
+   * neighbourhood held by the calling thread, and remains valid until the
+   * same thread next calls a method of any ConcurrentAdjacencyListLocalGraph.
+   */
+  class ConcurrentAdjacencyListLocalGraph : public LocalGraph {
+  public:
+    /**
+     * Construct a thread-safe local graph backed by an adjacency list file,
+     * with the default number of cache shards.
+     *
+     * The adjacency list file must not be modified externally while it is in
+     * use by this object.
+     *
+     * @param filename the name of the adjacencylist file which defines the graph
+     * @throws std::runtime_error if the file cannot be opened, or its node
+     *         IDs are not sorted
+     */
+    explicit ConcurrentAdjacencyListLocalGraph(const std::string& filename);
+
+    /**
+     * Construct a thread-safe local graph backed by an adjacency list file,
+     * with the given number of cache shards.
+     *
+     * Using more shards reduces the contention between threads, and should
+     * be several times the number of threads which use the graph.
+     *
+     * @param filename the name of the adjacencylist file which defines the graph
+     * @param num_shards the number of independently locked shards of the
+     *                   neighbourhood cache
+     * @throws std::runtime_error if the file cannot be opened, or its node
+     *         IDs are not sorted
+     * @throws std::invalid_argument if num_shards is not positive
+     */
+    ConcurrentAdjacencyListLocalGraph(const std::string& filename,
+                                      StagInt num_shards);
+
+    /**
+     * Save the index of the adjacency list file to the file `<filename>.idx`.
+     *
+     * See stag::AdjacencyListLocalGraph::save_index.
+     *
+     * @throws std::runtime_error if the index file cannot be written
+     */
+    void save_index() const;
+
+    /**
+     * Whether the index was loaded from a saved index file, rather than
+     * being built by reading the adjacency list file.
+     */
+    bool index_loaded() const;
+
+    /**
+     * Set the maximum number of bytes used to cache the neighbourhoods of
+     * the vertices which have been queried.
+     *
+     * The budget is divided equally between the shards of the cache, and
+     * each shard discards its least recently used neighbourhoods when its
+     * share of the budget is full.
+     *
+     * This method must not be called while other threads are using the
+     * graph.
+     *
+     * @param bytes the maximum number of bytes used by the cache
+     */
+    void set_cache_budget(StagUInt bytes);
+
+    /**
+     * The maximum number of bytes used to cache neighbourhoods. By default,
+     * this is unlimited.
+     */
+    StagUInt cache_budget() const;
+
+    /**
+     * The hit, miss and eviction counters of the neighbourhood cache, summed
+     * over its shards.
+     */
+    NeighborhoodCacheStats cache_stats() const;
+
+    /**
+     * Discard every cached neighbourhood.
+     *
+     * This method must not be called while other threads are using the
+     * graph.
+     */
+    void clear_cache();
+
     // Override the abstract methods in the LocalGraph base class.
     StagReal degree(StagInt v) override;
     StagInt degree_unweighted(StagInt v) override;
     std::vector<edge> neighbors(StagInt v) override;
     std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+    NeighborView neighbors_view(StagInt v) override;
     std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
     std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
     bool vertex_exists(StagInt v) override;
-    ~AdjacencyListLocalGraph() override;
+    void prefetch(std::span<const StagInt> vertices) override;
+    ~ConcurrentAdjacencyListLocalGraph() override = default;
 
   private:
+    // A shard of the neighborhood cache, and the lock which protects it.
+    struct CacheShard {
+      mutable std::mutex mutex;
+      NeighborhoodCache cache;
+    };
+
     /**
-     * Move the ifstream head to the start of the next content line, and return
-     * the ID of the corresponding node.
+     * Find the neighborhood of the vertex v in the cache, reading it from
+     * disk if it is not in the cache, and call f with a view of the cached
+     * neighborhood while holding the lock on its shard.
      *
-     * If there is no content line before the end of the file, return -1 and
-     * set the ifstream head to the end of the file.
+     * @throws std::runtime_error if the vertex is not in the file
+     */
+    template <typename Function>
+    auto with_neighborhood(StagInt v, Function f);
+
+    /**
+     * Call f with a view of the neighborhood of v, starting the search of
+     * the index from the given position if it is not in the cache.
      *
-     * @return the node ID of the next content line
+     * See stag::AdjacencyListFile::find_vertex.
+     */
+    template <typename Function>
+    auto with_neighborhood(StagInt v, StagInt* position, Function f);
+
+    // The adjacencylist file backing this graph, mapped into memory.
+    AdjacencyListFile file_;
+
+    // The shards of the neighborhood cache. The neighborhood of vertex v is
+    // cached in shard v mod num_shards.
+    std::vector<CacheShard> shards_;
+    StagUInt cache_budget_ = std::numeric_limits<StagUInt>::max();
+  };
+
+  /**
+   * \brief One adjacency list file of a stag::ShardedLocalGraph, holding the
+   * vertices in a range of IDs.
+   */
+  struct LocalGraphShard {
+    /**
+     * The smallest vertex ID held by the shard.
      */
-    StagInt goto_next_content_line();
+    StagInt first_vertex;
 
     /**
-     * Perform a binary search to find the given vertex in the adjacencylist
-     * file.
+     * The largest vertex ID held by the shard.
+     */
+    StagInt last_vertex;
+
+    /**
+     * The name of the adjacency list file of the shard.
+     */
+    std::string filename;
+  };
+
+  /**
+   * \brief A local graph split across several adjacency list files on disk.
+   *
+   * Each shard is an adjacency list file holding the content lines of the
+   * vertices in a range of IDs, and the ranges of the shards must not
+   * overlap. Every query is routed to the shard holding the vertex.
+   * This allows a graph written as many part files by parallel jobs to be
+   * used without first merging the parts into one file.
+   *
+   * The shards are described by a manifest file. Each content line of the
+   * manifest has the format `<first_vertex> <last_vertex> <filename>`, and
+   * lines beginning with `#` are ignored. Relative filenames are relative to
+   * the directory of the manifest. For example:
+   *
+   *     # first last filename
+   *     0 999999 part-0.adjacencylist
+   *     1000000 1999999 part-1.adjacencylist
+   *
+   * Each shard file is opened when it is first queried, and uses its saved
+   * index file if there is one. The neighbourhoods read from every shard
+   * share one cache, and so one cache budget.
+   *
+   * As for stag::AdjacencyListLocalGraph, a ShardedLocalGraph object must not
+   * be used by several threads at once.
+   */
+  class ShardedLocalGraph : public LocalGraph {
+  public:
+    /**
+     * Construct a local graph from the shards listed in a manifest file.
      *
-     * If the vertex v is defined, the input stream pointer will be pointing
-     * at the start of the corresponding content line.
+     * The shard files must not be modified externally while they are in use
+     * by this object.
      *
-     * If the vertex does not exist, will throw a runtime exception.
+     * @param manifest_filename the name of the manifest file
+     * @throws std::runtime_error if the manifest cannot be read, or the
+     *         ranges of the shards overlap
+     */
+    explicit ShardedLocalGraph(const std::string& manifest_filename);
+
+    /**
+     * Construct a local graph from the given shards.
      *
-     * @param v the vertex to search for
+     * @param shards the shards of the graph
+     * @throws std::runtime_error if the ranges of the shards overlap
+     */
+    explicit ShardedLocalGraph(std::vector<LocalGraphShard> shards);
+
+    /**
+     * The shards of the graph, in increasing order of vertex ID.
+     */
+    const std::vector<LocalGraphShard>& shards() const;
+
+    /**
+     * Set the maximum number of bytes used to cache the neighbourhoods of
+     * the vertices which have been queried, across every shard.
+     *
+     * See stag::AdjacencyListLocalGraph::set_cache_budget.
+     *
+     * @param bytes the maximum number of bytes used by the cache
+     */
+    void set_cache_budget(StagUInt bytes);
+
+    /**
+     * The maximum number of bytes used to cache neighbourhoods. By default,
+     * this is unlimited.
+     */
+    StagUInt cache_budget() const;
+
+    /**
+     * The hit, miss and eviction counters of the neighbourhood cache.
+     */
+    NeighborhoodCacheStats cache_stats() const;
+
+    /**
+     * Discard every cached neighbourhood.
      */
-    void find_vertex(StagInt v);
+    void clear_cache();
 
-    // The input file stream corresponding to the adjacencylist file backing
-    // this graph. The implementation makes random access to this file to
-    // read the vertex adjacency information.
-    std::ifstream is_;
-    std::streampos end_of_file_;
+    // Override the abstract methods in the LocalGraph base class.
+    StagReal degree(StagInt v) override;
+    StagInt degree_unweighted(StagInt v) override;
+    std::vector<edge> neighbors(StagInt v) override;
+    std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+    NeighborView neighbors_view(StagInt v) override;
+    std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
+    std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
+    bool vertex_exists(StagInt v) override;
+    void prefetch(std::span<const StagInt> vertices) override;
+    ~ShardedLocalGraph() override = default;
+
+  private:
+    /**
+     * The index of the shard whose range contains v, or -1 if there is no
+     * such shard.
+     */
+    StagInt find_shard(StagInt v) const;
+
+    /**
+     * The adjacency list file of the given shard, which is opened if this
+     * is the first time it is used.
+     */
+    const AdjacencyListFile& shard_file(StagInt shard);
+
+    /**
+     * Return the cached neighborhood of the vertex v, reading it from its
+     * shard if it is not in the cache.
+     *
+     * @param v the vertex to query
+     * @param position the position in the index of the shard to search from
+     * @throws std::runtime_error if the vertex is not in the graph
+     */
+    NeighborView load_neighborhood(StagInt v, StagInt* position);
 
-    // In order to increase the efficiency of looking up neighbourhood
-    // information in the graph, we cache the node ids corresponding to certain
-    // locations in the file. The cached locations will correspond to the binary
-    // search locations for the nodes we've queried.
-    std::unordered_map<StagInt, StagInt> fileloc_to_node_id_;
+    // The shards, sorted by their first vertex, and their files, which are
+    // nullptr until the shard is first used.
+    std::vector<LocalGraphShard> shards_;
+    std::vector<std::unique_ptr<AdjacencyListFile>> files_;
 
-    // We also store the full adjacency list of the graph queried so far.
-    std::unordered_map<StagInt, std::vector<edge>> node_id_to_edgelist_;
+    // The neighborhoods of the vertices queried so far, from every shard.
+    NeighborhoodCache cache_;
   };
 
   /**
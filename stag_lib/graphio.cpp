@@ -6,133 +6,380 @@
 #include <fstream>
 #include <stdexcept>
 #include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <string_view>
+#include <thread>
+#include <future>
+#include <queue>
+#include <functional>
+#include "multithreading/ctpl_stl.h"
 
 #include "graph.h"
 #include "utility.h"
 #include "graphio.h"
 
+/*
+ * Text files smaller than this many bytes are loaded on a single thread, and
+ * larger files are split into chunks of at least this size, one for each
+ * thread.
+ */
+#define PARALLEL_LOAD_CUTOFF (1 << 22)
+
+/*
+ * Used to disable compiler warning for unused variable.
+ */
+template<class T> void ignore_warning(const T&){}
+
+/*
+ * The default maximum number of bytes of edges held in memory when sorting an
+ * edgelist file.
+ */
+#define EDGELIST_SORT_DEFAULT_MEMORY ((StagUInt) 1 << 30)
+
+/*
+ * The maximum number of sorted runs which are merged at once. If there are
+ * more runs, they are merged in several passes.
+ */
+#define EDGELIST_SORT_MAX_MERGE_RUNS 256
+
+/*
+ * The smallest number of edges read from or written to a sorted run at once.
+ */
+#define EDGELIST_SORT_MIN_READ_EDGES 4096
+
+/*
+ * Buffers with fewer edges than this are sorted on a single thread.
+ */
+#define EDGELIST_SORT_PARALLEL_CUTOFF 100000
+
 /**
- * Parse a single content line of an edgelist file. This method assumes that
- * the line is not a comment, and tries to parse either by splitting on commas
- * or whitespace.
+ * Reads the lines of a text file through a large buffer.
  *
- * @return a triple representing the edge (u, v, weight).
- * @throw std::invalid_argument the line cannot be parsed
+ * Each line is returned as a view into the buffer, without its line ending,
+ * which is valid until the next line is read. Lines may end with "\n",
+ * "\r\n" or "\r", as for stag::safeGetline.
  */
-stag::edge parse_edgelist_content_line(std::string line) {
-  // List the possible delimiters for the elements on the line
-  std::vector<std::string> delimiters{",", " ", "\t"};
+class LineReader {
+  public:
+    /**
+     * Open the given file.
+     *
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    explicit LineReader(const std::string& filename)
+        : is_(filename, std::ios::binary), buffer_(1 << 20) {
+      if (!is_.is_open()) {
+        throw std::runtime_error(std::strerror(errno));
+      }
+    }
 
-  // Split the line to extract the edge information
-  // The weight defaults to 1 if it is not otherwise updated by the information
-  // in the line.
-  StagUInt num_tokens_found = 0;
-  StagInt u = -1;
-  StagInt v = -1;
-  StagReal weight = 1;
+    /**
+     * Read the next line of the file.
+     *
+     * @return false, and an empty line, if there are no more lines
+     */
+    bool next(std::string_view* line) {
+      for (;;) {
+        // Look for the end of the line in the buffered data.
+        char* begin = buffer_.data() + start_;
+        char* end = buffer_.data() + end_;
+        char* newline = begin;
+        while (newline < end && *newline != '\n' && *newline != '\r') newline++;
+
+        // A "\r" at the end of the buffer may be followed by "\n".
+        if (newline < end && (newline + 1 < end || *newline == '\n' || eof_)) {
+          *line = std::string_view(begin, newline - begin);
+          StagUInt length = newline - begin + 1;
+          if (*newline == '\r' && newline + 1 < end && newline[1] == '\n') length++;
+          start_ += length;
+          return true;
+        }
 
-  // Try splitting by each delimiter in turn
-  size_t split_pos = 0;
-  std::string token;
-  for (const std::string &delimiter: delimiters) {
-    // If we have not found any delimiters of the previous types yet,
-    // then try this one.
-    if (num_tokens_found == 0) {
-      while ((split_pos = line.find(delimiter)) != std::string::npos) {
-        // Extract the portion of the line up to the delimiter
-        token = line.substr(0, split_pos);
-        line.erase(0, split_pos + delimiter.length());
-
-        // If the token has length 0, then skip
-        if (token.length() == 0) continue;
-
-        // Parse the token as the appropriate data type - int or double
-        // throws an exception if the token cannot be parsed.
-        if (num_tokens_found == 0) u = std::stoi(token);
-        if (num_tokens_found == 1) v = std::stoi(token);
-        if (num_tokens_found == 2) weight = std::stod(token);
-
-        // Increase the counter of the number of tokens found
-        num_tokens_found++;
+        if (eof_) {
+          // The last line of the file may have no line ending. At the end of
+          // the file, the line is left empty.
+          *line = std::string_view();
+          if (begin == end) return false;
+          *line = std::string_view(begin, end - begin);
+          start_ = end_;
+          return true;
+        }
+        refill_();
       }
     }
-  }
 
-  // Extract the final token in the line
-  if (num_tokens_found == 1) {
-    v = std::stoi(line);
-    num_tokens_found++;
-  } else if (num_tokens_found == 2) {
-    try {
-      // Try extracting the weight from the rest of the line, but ignore any
-      // errors - the weight might not be there.
-      weight = std::stod(line);
-      num_tokens_found++;
-    } catch (std::exception &e) {
-      // Ignore this
+    /**
+     * The position in the file of the next line.
+     */
+    StagUInt position() const {
+      return file_position_ - (end_ - start_);
     }
-  }
 
-  // Check that we have exactly two or three elements in the split line
-  if (num_tokens_found < 2 || num_tokens_found > 3) {
-    throw std::invalid_argument("Wrong number of tokens on edgelist line.");
-  }
+    /**
+     * Continue reading from the given position in the file.
+     */
+    void seek(StagUInt position) {
+      is_.clear();
+      is_.seekg((std::streamoff) position);
+      file_position_ = position;
+      start_ = 0;
+      end_ = 0;
+      eof_ = false;
+    }
 
-  // Make sure that the vertices u and v have been updated successfully
-  if (u < 0 || v < 0) {
-    throw std::invalid_argument("Parse error on edgelist line.");
+  private:
+    /**
+     * Move the unread data to the start of the buffer, and read more of the
+     * file after it.
+     */
+    void refill_() {
+      StagUInt remaining = end_ - start_;
+      std::memmove(buffer_.data(), buffer_.data() + start_, remaining);
+      start_ = 0;
+      end_ = remaining;
+
+      // Grow the buffer if a single line fills it.
+      if (end_ == buffer_.size()) buffer_.resize(2 * buffer_.size());
+
+      is_.read(buffer_.data() + end_, (std::streamsize) (buffer_.size() - end_));
+      auto read = (StagUInt) is_.gcount();
+      end_ += read;
+      file_position_ += read;
+      if (read == 0) eof_ = true;
+    }
+
+    std::ifstream is_;
+    std::vector<char> buffer_;
+    StagUInt start_ = 0;
+    StagUInt end_ = 0;
+    StagUInt file_position_ = 0;
+    bool eof_ = false;
+};
+
+/**
+ * Whether a line of an edgelist or adjacencylist file has content, rather
+ * than being blank or a comment.
+ */
+bool is_content_line(std::string_view line) {
+  return !line.empty() && line[0] != '#' && line[0] != '/';
+}
+
+/**
+ * Split the next line from the start of the given text, which is advanced past
+ * the line and its line ending.
+ *
+ * @return false if there are no more lines
+ */
+bool next_line(std::string_view& text, std::string_view* line) {
+  if (text.empty()) return false;
+  StagUInt length = text.find_first_of("\r\n");
+  if (length == std::string_view::npos) length = text.size();
+  *line = text.substr(0, length);
+
+  StagUInt ending = 0;
+  if (length < text.size()) {
+    ending = (text[length] == '\r' && length + 1 < text.size()
+              && text[length + 1] == '\n') ? 2 : 1;
   }
+  text.remove_prefix(length + ending);
+  return true;
+}
 
-  // Return the triple
-  return {u, v, weight};
+/**
+ * The start of the first line which begins at or after the given offset in
+ * the text.
+ */
+StagUInt line_start_at_or_after(std::string_view text, StagUInt offset) {
+  if (offset == 0) return 0;
+
+  // Find the end of the line containing the byte before the offset.
+  StagUInt end = text.find_first_of("\r\n", offset - 1);
+  if (end == std::string_view::npos) return text.size();
+  if (text[end] == '\r' && end + 1 < text.size() && text[end + 1] == '\n') end++;
+  return end + 1;
 }
 
-stag::Graph stag::load_edgelist(std::string &filename) {
-  // Attempt to open the provided file
-  std::ifstream is(filename);
+/**
+ * Parse the lines of a text file on several threads.
+ *
+ * The file is split into one chunk per thread, with the boundaries between the
+ * chunks aligned to the starts of lines, and parse_line(line, triplets) is
+ * called for every line of each chunk, to append the matrix entries on that
+ * line to the triplets of the chunk. The chunks are returned in the order in
+ * which they appear in the file.
+ *
+ * @throws std::runtime_error if the file cannot be read, or any line cannot
+ *                            be parsed
+ */
+template <typename Func>
+std::vector<std::vector<EdgeTriplet>> parse_file_in_chunks(
+    const std::string& filename, Func parse_line) {
+  stag::MappedFile file(filename);
+  if (file.size() > 0 && file.data() == nullptr) {
+    throw std::runtime_error("Couldn't map file " + filename);
+  }
+  std::string_view text(file.data(), file.size());
 
-  // If the file could not be opened, throw an exception
-  if (!is.is_open()) {
-    throw std::runtime_error(std::strerror(errno));
+  // Small files are parsed on the calling thread.
+  StagInt num_chunks = 1;
+  if (text.size() >= PARALLEL_LOAD_CUTOFF) {
+    num_chunks = MAX((StagInt) std::thread::hardware_concurrency(), 1);
+    num_chunks = MIN(num_chunks, (StagInt) (text.size() / PARALLEL_LOAD_CUTOFF));
   }
 
-  // We will construct a vector of triples in order to construct the final
-  // adjacency matrix
-  std::vector<EdgeTriplet> non_zero_entries;
+  std::vector<StagUInt> chunk_starts;
+  for (StagInt chunk_id = 0; chunk_id <= num_chunks; chunk_id++) {
+    chunk_starts.push_back(
+        line_start_at_or_after(text, chunk_id * text.size() / num_chunks));
+  }
 
-  // Read the file in one line at a time
-  StagInt number_of_vertices = 0;
-  std::string line;
-  stag::edge this_edge;
-  while (stag::safeGetline(is, line)) {
-    if (line[0] != '#' && line[0] != '/' && line.length() > 0) {
+  // Each chunk is parsed into its own vector of triplets. Parsing errors are
+  // re-thrown as runtime errors.
+  std::vector<std::vector<EdgeTriplet>> triplets(num_chunks);
+  auto parse_chunk = [&](StagInt chunk_id) {
+    std::string_view chunk = text.substr(
+        chunk_starts[chunk_id], chunk_starts[chunk_id + 1] - chunk_starts[chunk_id]);
+    std::string_view line;
+    while (next_line(chunk, &line)) {
       try {
-        // This line of the input file isn't a comment, parse it.
-        this_edge = parse_edgelist_content_line(line);
-
-        // Add two edges to the adjacency matrix in order to keep it symmetric.
-        non_zero_entries.emplace_back(
-            EdgeTriplet(this_edge.v1, this_edge.v2, this_edge.weight));
-        non_zero_entries.emplace_back(
-            EdgeTriplet(this_edge.v2, this_edge.v1, this_edge.weight));
-
-        // Update the number of vertices to be the maximum of the column and row
-        // indices.
-        number_of_vertices = std::max(number_of_vertices, this_edge.v1 + 1);
-        number_of_vertices = std::max(number_of_vertices, this_edge.v2 + 1);
+        parse_line(line, triplets[chunk_id]);
       } catch (std::invalid_argument &e) {
-        // Re-throw any parsing errors
         throw(std::runtime_error(e.what()));
       }
     }
+  };
+
+  if (num_chunks == 1) {
+    parse_chunk(0);
+    return triplets;
   }
 
-  // Close the input file stream
-  is.close();
+  ctpl::thread_pool pool((int) num_chunks);
+  std::vector<std::future<void>> futures;
+  for (StagInt chunk_id = 0; chunk_id < num_chunks; chunk_id++) {
+    futures.push_back(
+        pool.push(
+            [&parse_chunk, chunk_id] (int id) {
+              ignore_warning(id);
+              parse_chunk(chunk_id);
+            }
+        )
+    );
+  }
+
+  // Wait for every chunk before reporting the first error in the file.
+  std::exception_ptr error;
+  for (auto& future : futures) {
+    try {
+      future.get();
+    } catch (...) {
+      if (!error) error = std::current_exception();
+    }
+  }
+  if (error) std::rethrow_exception(error);
+
+  return triplets;
+}
+
+/**
+ * The number of vertices of a graph with the given adjacency matrix entries.
+ */
+StagInt number_of_vertices_in(const std::vector<std::vector<EdgeTriplet>>& triplets) {
+  StagInt number_of_vertices = 0;
+  for (const auto& chunk : triplets) {
+    for (const EdgeTriplet& t : chunk) {
+      number_of_vertices = std::max(number_of_vertices, t.row() + 1);
+      number_of_vertices = std::max(number_of_vertices, t.col() + 1);
+    }
+  }
+  return number_of_vertices;
+}
+
+/**
+ * Parse a single content line of an edgelist file. This method assumes that
+ * the line is not a comment.
+ *
+ * The line is split into tokens in a single pass, treating any sequence of
+ * commas, spaces and tabs as a separator. The first two tokens are the
+ * vertices of the edge, and the optional third token is its weight.
+ *
+ * @return a triple representing the edge (u, v, weight).
+ * @throw std::invalid_argument the line cannot be parsed
+ */
+stag::edge parse_edgelist_content_line(std::string_view line) {
+  const char* pos = line.data();
+  const char* end = line.data() + line.size();
+  auto is_separator = [](char c) { return c == ',' || c == ' ' || c == '\t'; };
+
+  // The weight defaults to 1 if it is not given on the line.
+  StagInt ids[2];
+  StagReal weight = 1;
+  StagUInt num_tokens_found = 0;
+  for (;;) {
+    while (pos < end && is_separator(*pos)) pos++;
+    if (pos == end) break;
+
+    const char* token_end = pos;
+    while (token_end < end && !is_separator(*token_end)) token_end++;
+
+    // Parse the token as the appropriate data type - int or double.
+    if (*pos == '+') pos++;
+    std::from_chars_result result;
+    if (num_tokens_found < 2) {
+      result = std::from_chars(pos, token_end, ids[num_tokens_found]);
+    } else if (num_tokens_found == 2) {
+      result = std::from_chars(pos, token_end, weight);
+    } else {
+      throw std::invalid_argument("Wrong number of tokens on edgelist line.");
+    }
+    if (result.ec != std::errc() || result.ptr != token_end) {
+      throw std::invalid_argument("Parse error on edgelist line.");
+    }
+
+    num_tokens_found++;
+    pos = token_end;
+  }
 
-  // Update the adjacency matrix from the triples constructed from the input file.
-  SprsMat adj_mat(number_of_vertices, number_of_vertices);
-  adj_mat.setFromTriplets(non_zero_entries.begin(), non_zero_entries.end());
+  // Check that we have two or three elements on the line
+  if (num_tokens_found < 2) {
+    throw std::invalid_argument("Wrong number of tokens on edgelist line.");
+  }
+
+  // Make sure that the vertices u and v are valid
+  if (ids[0] < 0 || ids[1] < 0) {
+    throw std::invalid_argument("Parse error on edgelist line.");
+  }
+
+  // Return the triple
+  return {ids[0], ids[1], weight};
+}
+
+stag::Graph stag::load_edgelist(std::string &filename) {
+  // Parse the file in chunks, constructing a vector of triples for each chunk
+  // in order to construct the final adjacency matrix. If the file could not be
+  // opened, an exception is thrown.
+  std::vector<std::vector<EdgeTriplet>> non_zero_entries = parse_file_in_chunks(
+      filename, [](std::string_view line, std::vector<EdgeTriplet>& triplets) {
+        if (is_content_line(line)) {
+          // This line of the input file isn't a comment, parse it.
+          stag::edge this_edge = parse_edgelist_content_line(line);
+
+          // Add two edges to the adjacency matrix in order to keep it
+          // symmetric.
+          triplets.emplace_back(this_edge.v1, this_edge.v2, this_edge.weight);
+          triplets.emplace_back(this_edge.v2, this_edge.v1, this_edge.weight);
+        }
+      });
+
+  // Construct the adjacency matrix from the triples constructed from the input
+  // file, and release the memory used by the triples.
+  StagInt number_of_vertices = number_of_vertices_in(non_zero_entries);
+  SprsMat adj_mat = stag::sprsMatFromTriplets(
+      non_zero_entries, number_of_vertices, number_of_vertices);
+  std::vector<std::vector<EdgeTriplet>>().swap(non_zero_entries);
 
   // Construct and return the graph object
   return stag::Graph(adj_mat);
@@ -157,8 +404,9 @@ void stag::save_edgelist(stag::Graph &graph, std::string &filename) {
   const SprsMat* adj_mat = graph.adjacency();
   for (int k = 0; k < adj_mat->outerSize(); ++k) {
     for (SprsMat::InnerIterator it(*adj_mat, k); it; ++it) {
-      // We only consider the 'upper triangle' of the matrix
-      if (it.col() > it.row()) {
+      // We only consider the 'upper triangle' of the matrix, and skip the
+      // tombstones of edges removed from a dynamic graph.
+      if (it.col() > it.row() && it.value() != 0) {
         os << it.row() << " " << it.col() << " " << it.value() << std::endl;
       }
     }
@@ -174,10 +422,7 @@ void stag::save_edgelist(stag::Graph &graph, std::string &filename) {
 
 void stag::copy_edgelist_duplicate_edges(std::string& infile, std::string& outfile) {
   // Open the input file
-  std::ifstream is(infile);
-  if (!is.is_open()) {
-    throw std::runtime_error(std::strerror(errno));
-  }
+  LineReader reader(infile);
 
   // Open the output file
   std::ofstream os(outfile);
@@ -186,246 +431,451 @@ void stag::copy_edgelist_duplicate_edges(std::string& infile, std::string& outfi
   }
 
   // Read the file in one line at a time
-  std::string line;
+  std::string_view line;
   stag::edge this_edge;
-  while (stag::safeGetline(is, line)) {
-    if (line[0] != '#' && line[0] != '/' && line.length() > 0) {
+  while (reader.next(&line)) {
+    if (is_content_line(line)) {
       try {
         // This line of the input file isn't a comment, parse it.
         this_edge = parse_edgelist_content_line(line);
 
         // And write both directions to the output file
-        os << this_edge.v1 << " " << this_edge.v2 << " " << this_edge.weight << std::endl;
-        os << this_edge.v2 << " " << this_edge.v1 << " " << this_edge.weight << std::endl;
+        os << this_edge.v1 << " " << this_edge.v2 << " " << this_edge.weight << '\n';
+        os << this_edge.v2 << " " << this_edge.v1 << " " << this_edge.weight << '\n';
       } catch (std::invalid_argument &e) {
         // Re-throw any parsing errors
         throw(std::runtime_error(e.what()));
       }
     } else {
       // This line is a comment - pass it verbatim to the output
-      os << line << std::endl;
+      os << line << '\n';
     }
   }
 
-  // Close the file streams
-  is.close();
+  // Close the output file stream
   os.close();
 }
 
 /**
- * Get the number of lines and maximum ID in an edgelist file.
- *
- * This has running time O(n) where n is the number of lines in the edgelist
- * file.
+ * A sorted run of edges, which is read in order through a buffer. The run is
+ * either held in memory, or stored in a binary temporary file.
  */
-void get_edgelist_lines_and_nodes(std::string& filename, StagInt& lines,
-                                  StagInt& max_id) {
-  // Open the input file
-  std::ifstream is(filename);
-  if (!is.is_open()) {
-    throw std::runtime_error(std::strerror(errno));
-  }
+class EdgeRun {
+  public:
+    /**
+     * A run of the edges in memory between begin and end.
+     */
+    EdgeRun(const stag::edge* begin, const stag::edge* end)
+        : pos_(begin), end_(end) {}
+
+    /**
+     * A run stored in the given file, read through a buffer of the given
+     * number of edges.
+     *
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    EdgeRun(const std::string& filename, StagUInt buffer_edges)
+        : is_(filename, std::ios::binary), buffer_(buffer_edges) {
+      if (!is_.is_open()) {
+        throw std::runtime_error(std::strerror(errno));
+      }
+      refill_();
+    }
 
-  // Find the number of lines and the maximum node ID in the edgelist file
-  max_id = 0;
-  lines = 0;
-  std::string line;
-  stag::edge this_edge;
-  while (stag::safeGetline(is, line)) {
-    lines++;
+    /**
+     * Whether every edge in the run has been read.
+     */
+    bool empty() const {
+      return pos_ == end_;
+    }
 
-    if (line[0] != '#' && line[0] != '/' && line.length() > 0) {
-      try {
-        // This line of the input file isn't a comment, parse it.
-        this_edge = parse_edgelist_content_line(line);
+    /**
+     * The next edge in the run.
+     */
+    const stag::edge& front() const {
+      return *pos_;
+    }
 
-        // Update the number of vertices to be the maximum of the column and row
-        // indices.
-        max_id = std::max(max_id, this_edge.v1 + 1);
-        max_id = std::max(max_id, this_edge.v2 + 1);
-      } catch (std::invalid_argument &e) {
-        // Re-throw any parsing errors
-        throw(std::runtime_error(e.what()));
+    /**
+     * Move on to the next edge in the run.
+     */
+    void pop() {
+      if (++pos_ == end_ && is_.is_open()) refill_();
+    }
+
+  private:
+    void refill_() {
+      is_.read((char*) buffer_.data(),
+               (std::streamsize) (buffer_.size() * sizeof(stag::edge)));
+      pos_ = buffer_.data();
+      end_ = pos_ + is_.gcount() / sizeof(stag::edge);
+    }
+
+    std::ifstream is_;
+    std::vector<stag::edge> buffer_;
+    const stag::edge* pos_ = nullptr;
+    const stag::edge* end_ = nullptr;
+};
+
+/**
+ * Writes a run of edges to a binary temporary file, through a buffer.
+ */
+class EdgeRunWriter {
+  public:
+    /**
+     * @throws std::runtime_error if the file cannot be created
+     */
+    explicit EdgeRunWriter(const std::string& filename)
+        : os_(filename, std::ios::binary) {
+      if (!os_.is_open()) {
+        throw std::runtime_error(std::strerror(errno));
       }
+      buffer_.reserve(EDGELIST_SORT_MIN_READ_EDGES);
+    }
+
+    void write(const stag::edge& e) {
+      buffer_.push_back(e);
+      if (buffer_.size() == EDGELIST_SORT_MIN_READ_EDGES) flush_();
     }
+
+    /**
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void close() {
+      flush_();
+      os_.close();
+      if (!os_) throw std::runtime_error("Couldn't write temporary file.");
+    }
+
+  private:
+    void flush_() {
+      os_.write((const char*) buffer_.data(),
+                (std::streamsize) (buffer_.size() * sizeof(stag::edge)));
+      buffer_.clear();
+    }
+
+    std::ofstream os_;
+    std::vector<stag::edge> buffer_;
+};
+
+/**
+ * Merge the given runs, each sorted by the first vertex of the edges, and call
+ * f(e) for every edge e in sorted order. Edges with the same first vertex are
+ * passed in the order of their runs.
+ */
+template <typename Func>
+void merge_edge_runs(std::vector<EdgeRun>& runs, Func f) {
+  // The heap holds the first vertex of the next edge of each run, together
+  // with the index of the run to break ties.
+  using HeapEntry = std::pair<StagInt, StagUInt>;
+  std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<>> heap;
+  for (StagUInt i = 0; i < runs.size(); i++) {
+    if (!runs[i].empty()) heap.emplace(runs[i].front().v1, i);
   }
 
-  // Close the input file - it will be re-opened in each iteration of the
-  // quicksort algorithm.
-  is.close();
+  while (!heap.empty()) {
+    StagUInt i = heap.top().second;
+    heap.pop();
+    f(runs[i].front());
+    runs[i].pop();
+    if (!runs[i].empty()) heap.emplace(runs[i].front().v1, i);
+  }
 }
 
 /**
- * A structure representing an interval for the quicksort algorithm for edgelist
- * files.
+ * Sorts edges by their first vertex with an external merge sort.
+ *
+ * The edges are collected in a buffer which holds at most half of the given
+ * number of bytes, since std::stable_sort may allocate scratch space as large
+ * as the range it sorts. Whenever the buffer is full, slices of the buffer are
+ * sorted on separate threads, and merged into a sorted run in a temporary
+ * file. Once every edge has been added, the buffer is freed, and the runs are
+ * merged together with read buffers sharing the whole memory limit.
+ *
+ * The sort is stable: edges with the same first vertex are returned in the
+ * order in which they were added. The temporary files are deleted when the
+ * sorter is destroyed.
  */
-struct EdgelistSortInterval {
-  StagInt start_line;
-  StagInt end_line;
-  StagInt min_id;
-  StagInt max_id;
-};
+class ExternalEdgeSorter {
+  public:
+    /**
+     * @param memory_limit the maximum number of bytes of edges held in memory
+     * @param temp_directory the directory in which to write the sorted runs,
+     *                       or an empty string for the system's temporary
+     *                       directory
+     * @throws std::invalid_argument if the memory limit is zero
+     */
+    ExternalEdgeSorter(StagUInt memory_limit, std::string temp_directory)
+        : temp_directory_(std::move(temp_directory)) {
+      if (memory_limit == 0) {
+        throw std::invalid_argument("Memory limit must be positive.");
+      }
+      memory_edges_ = MAX(memory_limit / sizeof(stag::edge), (StagUInt) 1);
+      buffer_capacity_ = MAX(memory_edges_ / 2, (StagUInt) 1);
+    }
 
-void stag::sort_edgelist(std::string &filename) {
-  // Find the number of lines and the maximum node ID in the edgelist file
-  StagInt max_id = 0;
-  StagInt num_lines = 0;
-  get_edgelist_lines_and_nodes(filename, num_lines, max_id);
-
-  // Initialise the vector of quicksort intervals
-  std::vector<EdgelistSortInterval> intervals;
-  intervals.push_back({0, num_lines - 1, 0, max_id});
-
-  // Iterate the quicksort algorithm until there are no intervals left.
-  while (!intervals.empty()) {
-    // Create a temporary file for this iteration.
-    std::ofstream os;
-    std::string temp_fname = stag::openTempFile(&os);
-    if (!os.is_open()) throw std::runtime_error(std::strerror(errno));
-
-    // Open the edgelist file as input
-    std::ifstream ifs(filename);
-    if (!ifs.is_open()) throw std::runtime_error(std::strerror(errno));
-
-    // Throughout the algorithm, we must maintain a record of which line of the
-    // input and output file we are pointing at.
-    StagInt current_input_line = 0;
-    StagInt current_output_line = 0;
-
-    // For each pass through the input file, output any header comment lines
-    // verbatim
-    bool written_content = false;
-
-    // For each interval, we will iterate over that portion of the input file
-    // twice.
-    std::string line;
-    stag::edge this_edge;
-    std::vector<EdgelistSortInterval> new_intervals;
-    for (EdgelistSortInterval interval : intervals) {
-      // The pivot index is half-way between the max and min.
-      StagInt double_pivot = interval.min_id + interval.max_id;
-      assert(double_pivot > 2 * interval.min_id);
-      assert(double_pivot < 2 * interval.max_id);
-
-      // First iteration: looking for edges with node_ids less than the pivot
-      while (current_input_line < interval.start_line) {
-        // Write out every line up to the start point.
-        stag::safeGetline(ifs, line);
-        os << line << std::endl;
-        current_output_line++;
-        current_input_line++;
+    ExternalEdgeSorter(const ExternalEdgeSorter& other) = delete;
+    ExternalEdgeSorter& operator=(const ExternalEdgeSorter& other) = delete;
+
+    ~ExternalEdgeSorter() {
+      std::error_code ec;
+      for (const std::string& filename : temp_files_) {
+        std::filesystem::remove(filename, ec);
       }
-      std::streampos start_loc = ifs.tellg();
-      assert(current_input_line == interval.start_line);
-
-      StagInt new_interval_start = current_output_line;
-      StagInt new_interval_min_id = interval.max_id;
-      StagInt new_interval_max_id = interval.min_id;
-
-      while (current_input_line < interval.end_line) {
-        stag::safeGetline(ifs, line);
-        current_input_line++;
-
-        if (line[0] != '#' && line[0] != '/' && line.length() > 0) {
-          try {
-            // This line of the input file isn't a comment, parse it.
-            this_edge = parse_edgelist_content_line(line);
-            written_content = true;
-
-            if (2 * this_edge.v1 < double_pivot) {
-              os << line << std::endl;
-              current_output_line++;
-
-              // Update the maxs and mins
-              if (this_edge.v1 < new_interval_min_id) new_interval_min_id = this_edge.v1;
-              if (this_edge.v1 > new_interval_max_id) new_interval_max_id = this_edge.v1;
-            }
-          } catch (std::invalid_argument &e) {
-            // Re-throw any parsing errors
-            throw(std::runtime_error(e.what()));
+    }
+
+    /**
+     * Add an edge to be sorted.
+     */
+    void add(const stag::edge& e) {
+      // The buffer grows geometrically, but never beyond the memory limit, so
+      // that sorting a small file uses little memory.
+      if (buffer_.size() == buffer_.capacity()) {
+        buffer_.reserve(MIN(MAX(2 * buffer_.capacity(), (StagUInt) 1024),
+                            buffer_capacity_));
+      }
+      buffer_.push_back(e);
+      if (buffer_.size() == buffer_capacity_) write_run_();
+    }
+
+    /**
+     * Call f(e) for every edge e which has been added, in sorted order.
+     * This method may be called only once.
+     */
+    template <typename Func>
+    void merge(Func f) {
+      // If any runs have been written to disk, the rest of the buffer is
+      // written as a final run, so that the memory is free for the merge.
+      if (run_files_.empty()) {
+        std::vector<StagUInt> slice_starts = sort_buffer_();
+        std::vector<EdgeRun> slices;
+        for (StagUInt i = 0; i + 1 < slice_starts.size(); i++) {
+          slices.emplace_back(buffer_.data() + slice_starts[i],
+                              buffer_.data() + slice_starts[i + 1]);
+        }
+        merge_edge_runs(slices, f);
+        return;
+      }
+      if (!buffer_.empty()) write_run_();
+      std::vector<stag::edge>().swap(buffer_);
+
+      // If there are too many runs to read at once, consecutive groups of
+      // runs are merged into longer runs, keeping the order of the runs.
+      while (run_files_.size() > EDGELIST_SORT_MAX_MERGE_RUNS) {
+        std::vector<std::string> merged_files;
+        for (StagUInt first = 0; first < run_files_.size();
+             first += EDGELIST_SORT_MAX_MERGE_RUNS) {
+          StagUInt last = MIN(first + EDGELIST_SORT_MAX_MERGE_RUNS,
+                              (StagUInt) run_files_.size());
+          std::vector<std::string> group(run_files_.begin() + first,
+                                         run_files_.begin() + last);
+          merged_files.push_back(new_temp_file_());
+          {
+            std::vector<EdgeRun> runs = open_runs_(group);
+            EdgeRunWriter writer(merged_files.back());
+            merge_edge_runs(runs, [&](const stag::edge& e) { writer.write(e); });
+            writer.close();
           }
-        } else {
-          if (!written_content) {
-            os << line << std::endl;
-            current_output_line++;
+
+          // Free the disk space used by the merged runs.
+          std::error_code ec;
+          for (const std::string& filename : group) {
+            std::filesystem::remove(filename, ec);
           }
         }
+        run_files_ = merged_files;
       }
 
-      assert(new_interval_max_id >= new_interval_min_id);
-      StagInt new_interval_end = current_output_line;
-      if (new_interval_end - new_interval_start > 1 &&
-          new_interval_max_id > new_interval_min_id) {
-        new_intervals.push_back({new_interval_start,
-                                 new_interval_end,
-                                 new_interval_min_id,
-                                 new_interval_max_id});
-      }
+      std::vector<EdgeRun> runs = open_runs_(run_files_);
+      merge_edge_runs(runs, f);
+    }
 
-      // Return to the start of this interval
-      ifs.seekg(start_loc);
-      current_input_line = interval.start_line;
+  private:
+    /**
+     * Sort slices of the buffer on separate threads.
+     *
+     * @return the start of every slice, followed by the end of the buffer
+     */
+    std::vector<StagUInt> sort_buffer_() {
+      StagInt num_slices = 1;
+      if (buffer_.size() >= EDGELIST_SORT_PARALLEL_CUTOFF) {
+        num_slices = MAX((StagInt) std::thread::hardware_concurrency(), 1);
+      }
+      std::vector<StagUInt> slice_starts;
+      for (StagInt i = 0; i <= num_slices; i++) {
+        slice_starts.push_back(i * buffer_.size() / num_slices);
+      }
 
-      new_interval_start = current_output_line;
-      new_interval_min_id = interval.max_id;
-      new_interval_max_id = interval.min_id;
+      auto by_first_vertex = [](const stag::edge& a, const stag::edge& b) {
+        return a.v1 < b.v1;
+      };
+      auto sort_slice = [&](StagInt i) {
+        std::stable_sort(buffer_.begin() + (StagInt) slice_starts[i],
+                         buffer_.begin() + (StagInt) slice_starts[i + 1],
+                         by_first_vertex);
+      };
+
+      if (num_slices == 1) {
+        sort_slice(0);
+        return slice_starts;
+      }
 
-      while (current_input_line < interval.end_line) {
-        stag::safeGetline(ifs, line);
-        current_input_line++;
+      ctpl::thread_pool pool((int) num_slices);
+      std::vector<std::future<void>> futures;
+      for (StagInt i = 0; i < num_slices; i++) {
+        futures.push_back(
+            pool.push(
+                [&sort_slice, i] (int id) {
+                  ignore_warning(id);
+                  sort_slice(i);
+                }
+            )
+        );
+      }
+      for (auto& future : futures) future.get();
+      return slice_starts;
+    }
 
-        if (line[0] != '#' && line[0] != '/' && line.length() > 0) {
-          try {
-            // This line of the input file isn't a comment, parse it.
-            this_edge = parse_edgelist_content_line(line);
+    /**
+     * Sort the buffer, write it to a new run, and empty the buffer.
+     */
+    void write_run_() {
+      std::vector<StagUInt> slice_starts = sort_buffer_();
+      std::vector<EdgeRun> slices;
+      for (StagUInt i = 0; i + 1 < slice_starts.size(); i++) {
+        slices.emplace_back(buffer_.data() + slice_starts[i],
+                            buffer_.data() + slice_starts[i + 1]);
+      }
 
-            if (2 * this_edge.v1 >= double_pivot) {
-              os << line << std::endl;
-              current_output_line++;
+      run_files_.push_back(new_temp_file_());
+      EdgeRunWriter writer(run_files_.back());
+      merge_edge_runs(slices, [&](const stag::edge& e) { writer.write(e); });
+      writer.close();
+      buffer_.clear();
+    }
 
-              // Update the maxs and mins
-              if (this_edge.v1 < new_interval_min_id) new_interval_min_id = this_edge.v1;
-              if (this_edge.v1 > new_interval_max_id) new_interval_max_id = this_edge.v1;
-            }
-          } catch (std::invalid_argument &e) {
-            // Re-throw any parsing errors
-            throw(std::runtime_error(e.what()));
-          }
-        }
+    /**
+     * Open the given runs for merging, dividing the memory limit between
+     * their buffers.
+     */
+    std::vector<EdgeRun> open_runs_(const std::vector<std::string>& filenames) {
+      StagUInt buffer_edges = MAX(memory_edges_ / filenames.size(),
+                                  (StagUInt) EDGELIST_SORT_MIN_READ_EDGES);
+      std::vector<EdgeRun> runs;
+      runs.reserve(filenames.size());
+      for (const std::string& filename : filenames) {
+        runs.emplace_back(filename, buffer_edges);
       }
+      return runs;
+    }
 
-      assert(new_interval_max_id >= new_interval_min_id);
-      new_interval_end = current_output_line;
-      if (new_interval_end - new_interval_start > 1 &&
-          new_interval_max_id > new_interval_min_id) {
-        new_intervals.push_back({new_interval_start,
-                                 new_interval_end,
-                                 new_interval_min_id,
-                                 new_interval_max_id});
-      }
+    /**
+     * Choose the name of a new temporary file, which is deleted when the
+     * sorter is destroyed.
+     */
+    std::string new_temp_file_() {
+      temp_files_.push_back(stag::getTempFilename(temp_directory_));
+      return temp_files_.back();
     }
 
-    // If the final interval does not include the last lines of the file, we
-    // need to output them verbatim.
-    while (current_input_line < num_lines - 1) {
-      stag::safeGetline(ifs, line);
-      current_input_line++;
-      os << line << std::endl;
-      current_output_line++;
+    std::string temp_directory_;
+
+    // The memory limit, and the capacity of the buffer, in numbers of edges.
+    StagUInt memory_edges_;
+    StagUInt buffer_capacity_;
+    std::vector<stag::edge> buffer_;
+
+    // The sorted runs which are waiting to be merged, in the order in which
+    // they were written.
+    std::vector<std::string> run_files_;
+
+    // Every temporary file created by the sorter.
+    std::vector<std::string> temp_files_;
+};
+
+/**
+ * Read the edges of an edgelist file into the given sorter. If both_directions
+ * is true, both directions of every edge are added.
+ *
+ * @return the comment lines before the first content line of the file, which
+ *         are kept as a header when the sorted edges are written
+ * @throws std::runtime_error if the file cannot be read or parsed
+ */
+std::string read_edgelist_into_sorter(std::string& filename,
+                                      ExternalEdgeSorter& sorter,
+                                      bool both_directions) {
+  LineReader reader(filename);
+
+  std::string header;
+  bool read_content = false;
+  std::string_view line;
+  while (reader.next(&line)) {
+    if (is_content_line(line)) {
+      try {
+        // This line of the input file isn't a comment, parse it.
+        stag::edge this_edge = parse_edgelist_content_line(line);
+        read_content = true;
+
+        sorter.add(this_edge);
+        if (both_directions) {
+          sorter.add({this_edge.v2, this_edge.v1, this_edge.weight});
+        }
+      } catch (std::invalid_argument &e) {
+        // Re-throw any parsing errors
+        throw(std::runtime_error(e.what()));
+      }
+    } else if (!read_content) {
+      header.append(line);
+      header.push_back('\n');
     }
+  }
+
+  return header;
+}
 
-    // Update the intervals
-    intervals = new_intervals;
+void stag::sort_edgelist(std::string &filename) {
+  stag::sort_edgelist(filename, EDGELIST_SORT_DEFAULT_MEMORY, "");
+}
 
-    // Close the streams.
-    ifs.close();
+void stag::sort_edgelist(std::string &filename, StagUInt memory_limit,
+                         const std::string& temp_directory) {
+  // Parse the file once, sorting the edges into runs on disk.
+  ExternalEdgeSorter sorter(memory_limit, temp_directory);
+  std::string header = read_edgelist_into_sorter(filename, sorter, false);
+
+  // Write the header comments, followed by the sorted edges, to a temporary
+  // file next to the edgelist file, and then rename it over the edgelist, so
+  // that the edges are not lost if the merge fails. The weights are written
+  // with the fewest digits which are read back as the same value.
+  std::string temp_filename = filename + ".tmp";
+  std::ofstream os(temp_filename, std::ios::binary);
+  if (!os.is_open()) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  try {
+    os << header;
+    char text[128];
+    sorter.merge([&](const stag::edge& e) {
+      char* pos = text;
+      char* end = text + sizeof(text);
+      pos = std::to_chars(pos, end, e.v1).ptr;
+      *pos++ = ' ';
+      pos = std::to_chars(pos, end, e.v2).ptr;
+      *pos++ = ' ';
+      pos = std::to_chars(pos, end, e.weight).ptr;
+      *pos++ = '\n';
+      os.write(text, pos - text);
+    });
     os.close();
-
-    // Copy the temporary file over the original edgelist.
-    std::filesystem::remove(filename);
-    std::filesystem::copy(temp_fname, filename);
-    std::filesystem::remove(temp_fname);
+    if (os.fail()) {
+      throw std::runtime_error("Failed to write edgelist file " + filename);
+    }
+  } catch (...) {
+    os.close();
+    std::filesystem::remove(temp_filename);
+    throw;
   }
+  std::filesystem::rename(temp_filename, filename);
 }
 
 //------------------------------------------------------------------------------
@@ -499,51 +949,29 @@ std::vector<stag::edge> stag::parse_adjacencylist_content_line(std::string line)
 }
 
 stag::Graph stag::load_adjacencylist(std::string &filename) {
-  // Attempt to open the provided file
-  std::ifstream is(filename);
-
-  // If the file could not be opened, throw an exception
-  if (!is.is_open()) {
-    throw std::runtime_error(std::strerror(errno));
-  }
-
-  // We will construct a vector of triples in order to construct the final
-  // adjacency matrix
-  std::vector<EdgeTriplet> non_zero_entries;
-
-  // Read the file in one line at a time
-  StagInt number_of_vertices = 0;
-  std::string line;
-  std::vector<stag::edge> neighbours;
-  while (stag::safeGetline(is, line)) {
-    if (line[0] != '#' && line[0] != '/' && line.length() > 0) {
-      try {
-        // This line of the input file isn't a comment, parse it.
-        neighbours = stag::parse_adjacencylist_content_line(line);
-
-        // Add the edges to the adjacency matrix
-        for (auto this_edge : neighbours) {
-          non_zero_entries.emplace_back(
-              this_edge.v1, this_edge.v2, this_edge.weight);
-
-          // Update the number of vertices to be the maximum of the column and row
-          // indices.
-          number_of_vertices = std::max(number_of_vertices, this_edge.v1 + 1);
-          number_of_vertices = std::max(number_of_vertices, this_edge.v2 + 1);
+  // Parse the file in chunks, constructing a vector of triples for each chunk
+  // in order to construct the final adjacency matrix. If the file could not be
+  // opened, an exception is thrown.
+  std::vector<std::vector<EdgeTriplet>> non_zero_entries = parse_file_in_chunks(
+      filename, [](std::string_view line, std::vector<EdgeTriplet>& triplets) {
+        if (is_content_line(line)) {
+          // This line of the input file isn't a comment, parse it.
+          std::vector<stag::edge> neighbours =
+              stag::parse_adjacencylist_content_line(std::string(line));
+
+          // Add the edges to the adjacency matrix
+          for (auto this_edge : neighbours) {
+            triplets.emplace_back(this_edge.v1, this_edge.v2, this_edge.weight);
+          }
         }
-      } catch (std::invalid_argument &e) {
-        // Re-throw any parsing errors
-        throw(std::runtime_error(e.what()));
-      }
-    }
-  }
-
-  // Close the input file stream
-  is.close();
+      });
 
-  // Update the adjacency matrix from the triples constructed from the input file.
-  SprsMat adj_mat(number_of_vertices, number_of_vertices);
-  adj_mat.setFromTriplets(non_zero_entries.begin(), non_zero_entries.end());
+  // Construct the adjacency matrix from the triples constructed from the input
+  // file, and release the memory used by the triples.
+  StagInt number_of_vertices = number_of_vertices_in(non_zero_entries);
+  SprsMat adj_mat = stag::sprsMatFromTriplets(
+      non_zero_entries, number_of_vertices, number_of_vertices);
+  std::vector<std::vector<EdgeTriplet>>().swap(non_zero_entries);
 
   // Construct and return the graph object
   return stag::Graph(adj_mat);
@@ -572,7 +1000,7 @@ void stag::save_adjacencylist(stag::Graph &graph, std::string &filename) {
   for (StagInt node = 0; node < graph.number_of_vertices(); node++) {
     os << node << ":";
 
-    for (stag::edge e: graph.neighbors(node)) {
+    for (stag::edge e: graph.neighbors_view(node)) {
       os << " " << e.v2 << ":" << e.weight;
     }
 
@@ -630,55 +1058,770 @@ void stag::adjacencylist_to_edgelist(std::string &adjacencylist_fname, std::stri
 
 void stag::edgelist_to_adjacencylist(std::string &edgelist_fname,
                                      std::string &adjacencylist_fname) {
-  // Begin by copying and sorting the edgelist file
-  std::string temp_edgelist_filename = stag::getTempFilename();
-  stag::copy_edgelist_duplicate_edges(edgelist_fname, temp_edgelist_filename);
-  stag::sort_edgelist(temp_edgelist_filename);
-
-  // Open the input and output streams.
-  std::ifstream is(temp_edgelist_filename);
-  std::ofstream os(adjacencylist_fname);
+  stag::edgelist_to_adjacencylist(edgelist_fname, adjacencylist_fname,
+                                  EDGELIST_SORT_DEFAULT_MEMORY, "");
+}
 
+void stag::edgelist_to_adjacencylist(std::string &edgelist_fname,
+                                     std::string &adjacencylist_fname,
+                                     StagUInt memory_limit,
+                                     const std::string& temp_directory) {
+  // Parse the edgelist file once, sorting both directions of every edge.
   // We will include any comments up until the first content line.
   // This preserves 'header' information as a comment.
-  bool written_content = false;
+  ExternalEdgeSorter sorter(memory_limit, temp_directory);
+  std::string header = read_edgelist_into_sorter(edgelist_fname, sorter, true);
 
-  // Iterate through the edgelist file
+  // Open the output stream.
+  std::ofstream os(adjacencylist_fname);
+  if (!os.is_open()) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  os << header;
+
+  // Iterate through the sorted edges
   StagInt current_node = -1;
+  sorter.merge([&](const stag::edge& this_edge) {
+    // If this is a larger node than we've seen so far, begin a new
+    // line of the adjacency list file.
+    if (this_edge.v1 > current_node) {
+      os << '\n';
+      os << this_edge.v1 << ":";
+      current_node = this_edge.v1;
+    }
+
+    // Add the edge to the current line
+    os << " " << this_edge.v2 << ":" << this_edge.weight;
+  });
+
+  // Close the output file stream
+  os.close();
+}
+
+//------------------------------------------------------------------------------
+// Binary graph files
+//------------------------------------------------------------------------------
+#define BINARY_GRAPH_MAGIC "STAGCSR"
+#define BINARY_GRAPH_VERSION 1
+#define BINARY_GRAPH_BYTE_ORDER 0x01020304
+
+// The largest number of vertices or non-zero entries which can be stored in a
+// binary graph file, which ensures that the size of the file cannot overflow.
+#define BINARY_GRAPH_MAX_SIZE ((int64_t) 1 << 56)
+
+/**
+ * The header at the start of a STAG binary graph file.
+ *
+ * The header is followed by four arrays, each stored in the native byte
+ * order:
+ *   - the number_of_vertices + 1 column starts of the adjacency matrix
+ *   - the number_of_nonzeros row indices of the adjacency matrix
+ *   - the number_of_nonzeros values of the adjacency matrix
+ *   - the number_of_vertices weighted degrees of the vertices
+ */
+struct BinaryGraphHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t index_size;
+  uint32_t value_size;
+  int64_t number_of_vertices;
+  int64_t number_of_edges;
+  int64_t number_of_nonzeros;
+  int64_t reserved[2];
+};
+static_assert(sizeof(BinaryGraphHeader) == 64,
+              "The binary graph header must be 64 bytes.");
+
+/**
+ * The size in bytes of a binary graph file with the given header.
+ */
+StagUInt binary_graph_file_size(const BinaryGraphHeader& header) {
+  auto n = (StagUInt) header.number_of_vertices;
+  auto nnz = (StagUInt) header.number_of_nonzeros;
+  return sizeof(BinaryGraphHeader) + (n + 1) * sizeof(StagInt) +
+         nnz * (sizeof(StagInt) + sizeof(StagReal)) + n * sizeof(StagReal);
+}
+
+/**
+ * Check that the header describes a binary graph file which can be read on
+ * this machine, and which has the given size.
+ *
+ * @throws std::runtime_error if the check does not pass
+ */
+void check_binary_graph_header(const BinaryGraphHeader& header,
+                               StagUInt file_size,
+                               const std::string& filename) {
+  if (file_size < sizeof(BinaryGraphHeader) ||
+      std::strncmp(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic)) != 0) {
+    throw std::runtime_error(filename + " is not a STAG binary graph file.");
+  }
+  if (header.version != BINARY_GRAPH_VERSION) {
+    throw std::runtime_error("Unsupported STAG binary graph file version " +
+                             std::to_string(header.version) + ".");
+  }
+  if (header.byte_order != BINARY_GRAPH_BYTE_ORDER) {
+    throw std::runtime_error(
+        "STAG binary graph file was written with a different byte order.");
+  }
+  if (header.index_size != sizeof(StagInt) || header.value_size != sizeof(StagReal)) {
+    throw std::runtime_error(
+        "STAG binary graph file was written with different data types.");
+  }
+  if (header.number_of_vertices < 0 ||
+      header.number_of_vertices >= BINARY_GRAPH_MAX_SIZE ||
+      header.number_of_nonzeros < 0 ||
+      header.number_of_nonzeros >= BINARY_GRAPH_MAX_SIZE ||
+      binary_graph_file_size(header) != file_size) {
+    throw std::runtime_error("STAG binary graph file is corrupted.");
+  }
+}
+
+/**
+ * Check that the compressed column arrays of a binary graph file describe a
+ * valid n x n sparse matrix with nnz non-zero entries.
+ *
+ * @throws std::runtime_error if the check does not pass
+ */
+void check_binary_graph_arrays(StagInt n, StagInt nnz,
+                               const StagInt* outer_starts,
+                               const StagInt* inner_indices) {
+  bool valid = outer_starts[0] == 0 && outer_starts[n] == nnz;
+  for (StagInt v = 0; valid && v < n; v++) {
+    valid = outer_starts[v] <= outer_starts[v + 1];
+  }
+  for (StagInt k = 0; valid && k < nnz; k++) {
+    valid = inner_indices[k] >= 0 && inner_indices[k] < n;
+  }
+  if (!valid) {
+    throw std::runtime_error("STAG binary graph file is corrupted.");
+  }
+}
+
+void stag::save_binary(stag::Graph& graph, std::string& filename) {
+  // The arrays are written directly from the compressed adjacency matrix,
+  // without the tombstones of any removed edges.
+  const SprsMat* adj_mat = graph.adjacency();
+  SprsMat compressed_mat;
+  if (!adj_mat->isCompressed() || graph.number_of_tombstones() > 0) {
+    compressed_mat = *adj_mat;
+    compressed_mat.prune(0.0);
+    compressed_mat.makeCompressed();
+    adj_mat = &compressed_mat;
+  }
+
+  BinaryGraphHeader header = {};
+  std::strncpy(header.magic, BINARY_GRAPH_MAGIC, sizeof(header.magic));
+  header.version = BINARY_GRAPH_VERSION;
+  header.byte_order = BINARY_GRAPH_BYTE_ORDER;
+  header.index_size = sizeof(StagInt);
+  header.value_size = sizeof(StagReal);
+  header.number_of_vertices = graph.number_of_vertices();
+  header.number_of_edges = graph.number_of_edges();
+  header.number_of_nonzeros = adj_mat->nonZeros();
+
+  // Attempt to open the specified file
+  std::ofstream os(filename, std::ios::binary);
+  if (!os.is_open()) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+
+  StagInt n = header.number_of_vertices;
+  StagInt nnz = header.number_of_nonzeros;
+  os.write((const char*) &header, sizeof(header));
+  os.write((const char*) adj_mat->outerIndexPtr(), (n + 1) * sizeof(StagInt));
+  os.write((const char*) adj_mat->innerIndexPtr(), nnz * sizeof(StagInt));
+  os.write((const char*) adj_mat->valuePtr(), nnz * sizeof(StagReal));
+  os.write((const char*) graph.degree_vector()->data(), n * sizeof(StagReal));
+
+  os.close();
+  if (os.fail()) {
+    throw std::runtime_error("Failed to write binary graph file " + filename);
+  }
+}
+
+stag::Graph stag::load_binary(std::string& filename) {
+  // Attempt to open the provided file
+  std::ifstream is(filename, std::ios::binary);
+  if (!is.is_open()) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+
+  BinaryGraphHeader header = {};
+  is.read((char*) &header, sizeof(header));
+  check_binary_graph_header(header, std::filesystem::file_size(filename),
+                            filename);
+
+  // Read the arrays directly into the storage of the adjacency matrix. The
+  // degrees at the end of the file are recomputed by the graph.
+  StagInt n = header.number_of_vertices;
+  StagInt nnz = header.number_of_nonzeros;
+  SprsMat adj_mat(n, n);
+  adj_mat.resizeNonZeros(nnz);
+  is.read((char*) adj_mat.outerIndexPtr(), (n + 1) * sizeof(StagInt));
+  is.read((char*) adj_mat.innerIndexPtr(), nnz * sizeof(StagInt));
+  is.read((char*) adj_mat.valuePtr(), nnz * sizeof(StagReal));
+  if (is.fail()) {
+    throw std::runtime_error("Failed to read binary graph file " + filename);
+  }
+  is.close();
+
+  check_binary_graph_arrays(n, nnz, adj_mat.outerIndexPtr(), adj_mat.innerIndexPtr());
+  return stag::Graph(adj_mat);
+}
+
+//------------------------------------------------------------------------------
+// Memory-mapped binary graphs
+//------------------------------------------------------------------------------
+stag::MappedGraph::MappedGraph(const std::string& filename)
+    : file_(filename) {
+  BinaryGraphHeader header = {};
+  if (file_.size() >= sizeof(header)) {
+    std::memcpy(&header, file_.data(), sizeof(header));
+  }
+  check_binary_graph_header(header, file_.size(), filename);
+
+  number_of_vertices_ = header.number_of_vertices;
+  number_of_edges_ = header.number_of_edges;
+  number_of_nonzeros_ = header.number_of_nonzeros;
+
+  // The arrays follow the header. Every array is aligned to 8 bytes, since
+  // the header is 64 bytes long and the mapping begins at a page boundary.
+  const char* data = file_.data() + sizeof(header);
+  outer_starts_ = (const StagInt*) data;
+  inner_indices_ = outer_starts_ + number_of_vertices_ + 1;
+  values_ = (const StagReal*) (inner_indices_ + number_of_nonzeros_);
+  degrees_ = values_ + number_of_nonzeros_;
+
+  // Checking the whole of the arrays would read the entire file, so only
+  // their ends are checked here, and the start of the neighbors of each
+  // vertex is checked when it is used.
+  if (outer_starts_[0] != 0 || outer_starts_[number_of_vertices_] != number_of_nonzeros_) {
+    throw std::runtime_error("STAG binary graph file is corrupted.");
+  }
+}
+
+StagInt stag::MappedGraph::number_of_vertices() const {
+  return number_of_vertices_;
+}
+
+StagInt stag::MappedGraph::number_of_edges() const {
+  return number_of_edges_;
+}
+
+Eigen::Map<const SprsMat> stag::MappedGraph::adjacency() const {
+  check_binary_graph_arrays(number_of_vertices_, number_of_nonzeros_,
+                            outer_starts_, inner_indices_);
+  return {number_of_vertices_, number_of_vertices_, number_of_nonzeros_,
+          outer_starts_, inner_indices_, values_};
+}
+
+stag::Graph stag::MappedGraph::to_graph() const {
+  SprsMat adj_mat = adjacency();
+  return stag::Graph(adj_mat);
+}
+
+void stag::MappedGraph::check_vertex_argument(StagInt v) const {
+  if (v >= number_of_vertices_) {
+    throw std::invalid_argument("Specified vertex index too large.");
+  }
+  if (v < 0) {
+    throw std::invalid_argument("Vertex indices cannot be negative.");
+  }
+}
+
+void stag::MappedGraph::check_neighbors_range(StagInt v) const {
+  if (outer_starts_[v] < 0 || outer_starts_[v] > outer_starts_[v + 1] ||
+      outer_starts_[v + 1] > number_of_nonzeros_) {
+    throw std::runtime_error("STAG binary graph file is corrupted.");
+  }
+}
+
+StagReal stag::MappedGraph::degree(StagInt v) {
+  check_vertex_argument(v);
+  return degrees_[v];
+}
+
+StagInt stag::MappedGraph::degree_unweighted(StagInt v) {
+  check_vertex_argument(v);
+  check_neighbors_range(v);
+
+  // A self-loop contributes 1 to the degree, in addition to its entry in the
+  // neighbor array. The neighbors of each vertex are sorted.
+  const StagInt* start = inner_indices_ + outer_starts_[v];
+  const StagInt* end = inner_indices_ + outer_starts_[v + 1];
+  StagInt self_loop = std::binary_search(start, end, v) ? 1 : 0;
+  return outer_starts_[v + 1] - outer_starts_[v] + self_loop;
+}
+
+std::vector<stag::edge> stag::MappedGraph::neighbors(StagInt v) {
+  stag::NeighborView view = neighbors_view(v);
+  return {view.begin(), view.end()};
+}
+
+std::vector<StagInt> stag::MappedGraph::neighbors_unweighted(StagInt v) {
+  check_vertex_argument(v);
+  check_neighbors_range(v);
+  return {inner_indices_ + outer_starts_[v], inner_indices_ + outer_starts_[v + 1]};
+}
+
+stag::NeighborView stag::MappedGraph::neighbors_view(StagInt v) {
+  check_vertex_argument(v);
+  check_neighbors_range(v);
+
+  // The view points directly into the mapped file.
+  StagInt start = outer_starts_[v];
+  return {v, inner_indices_ + start, values_ + start, outer_starts_[v + 1] - start};
+}
+
+std::vector<StagReal> stag::MappedGraph::degrees(std::vector<StagInt> vertices) {
+  std::vector<StagReal> degs;
+  degs.reserve(vertices.size());
+  for (StagInt v : vertices) degs.push_back(degree(v));
+  return degs;
+}
+
+std::vector<StagInt> stag::MappedGraph::degrees_unweighted(std::vector<StagInt> vertices) {
+  std::vector<StagInt> degs;
+  degs.reserve(vertices.size());
+  for (StagInt v : vertices) degs.push_back(degree_unweighted(v));
+  return degs;
+}
+
+bool stag::MappedGraph::vertex_exists(StagInt v) {
+  return v >= 0 && v < number_of_vertices_;
+}
+
+void stag::MappedGraph::prefetch(std::span<const StagInt> vertices) {
+  // Prefetch the neighbor ids and weights of each vertex.
+  for (StagInt v : vertices) {
+    if (!vertex_exists(v)) continue;
+    check_neighbors_range(v);
+    StagInt start = outer_starts_[v];
+    StagInt size = outer_starts_[v + 1] - start;
+    file_.prefetch((const char*) (inner_indices_ + start) - file_.data(),
+                   size * sizeof(StagInt));
+    file_.prefetch((const char*) (values_ + start) - file_.data(),
+                   size * sizeof(StagReal));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Compact adjacency list files
+//------------------------------------------------------------------------------
+#define COMPACT_ADJACENCYLIST_MAGIC "STAGCAL"
+#define COMPACT_ADJACENCYLIST_VERSION 1
+
+/**
+ * The header at the start of a compact adjacency list file.
+ *
+ * The header is followed by the number_of_vertices + 1 offsets of the
+ * encoded neighborhoods, and then the data_size bytes of encoded
+ * neighborhoods. The encoded neighborhood of vertex v is
+ *   - the number of neighbors, as a varint
+ *   - the zigzag-encoded difference between the first neighbor and v, as a
+ *     varint
+ *   - the differences between consecutive neighbors, as varints
+ *   - the weights of the edges, as floats or doubles
+ * A vertex which is not in the graph has an empty neighborhood.
+ */
+struct CompactAdjacencyListHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t weight_encoding;
+  uint32_t reserved_flags;
+  int64_t number_of_vertices;
+  int64_t number_of_nonzeros;
+  int64_t data_size;
+  int64_t reserved[2];
+};
+static_assert(sizeof(CompactAdjacencyListHeader) == 64,
+              "The compact adjacency list header must be 64 bytes.");
+
+/**
+ * The number of bytes used to store each edge weight.
+ */
+StagInt compact_weight_size(stag::CompactWeights weights) {
+  if (weights == stag::DoubleWeights) return sizeof(double);
+  if (weights == stag::FloatWeights) return sizeof(float);
+  return 0;
+}
+
+/**
+ * Append an unsigned integer to the buffer with a variable-length encoding,
+ * using seven bits of each byte.
+ */
+void append_varint(std::string& buffer, uint64_t value) {
+  while (value >= 0x80) {
+    buffer.push_back((char) ((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back((char) value);
+}
+
+/**
+ * Read a variable-length integer from the buffer, advancing the pointer.
+ *
+ * @throws std::runtime_error if the integer runs past the end of the buffer
+ */
+uint64_t read_varint(const unsigned char*& data, const unsigned char* end) {
+  uint64_t value = 0;
+  for (int shift = 0; data < end && shift < 64; shift += 7) {
+    unsigned char byte = *data++;
+    value |= (uint64_t) (byte & 0x7F) << shift;
+    if (byte < 0x80) return value;
+  }
+  throw std::runtime_error("Compact adjacency list file is corrupted.");
+}
+
+/**
+ * Writes a compact adjacency list file, one neighborhood at a time.
+ */
+class CompactAdjacencyListWriter {
+  public:
+    CompactAdjacencyListWriter(const std::string& filename,
+                               StagInt number_of_vertices,
+                               stag::CompactWeights weights)
+        : filename_(filename), os_(filename, std::ios::binary),
+          weights_(weights) {
+      if (!os_.is_open()) {
+        throw std::runtime_error(std::strerror(errno));
+      }
+      header_ = {};
+      std::strncpy(header_.magic, COMPACT_ADJACENCYLIST_MAGIC,
+                   sizeof(header_.magic));
+      header_.version = COMPACT_ADJACENCYLIST_VERSION;
+      header_.byte_order = BINARY_GRAPH_BYTE_ORDER;
+      header_.weight_encoding = weights;
+      header_.number_of_vertices = number_of_vertices;
+      offsets_.reserve(number_of_vertices + 1);
+      offsets_.push_back(0);
+
+      // The header and offsets are written when the file is closed.
+      os_.seekp(sizeof(header_) + (number_of_vertices + 1) * sizeof(uint64_t));
+    }
+
+    /**
+     * Add the neighborhood of v to the file. The vertices must be added in
+     * increasing order.
+     *
+     * @throws std::runtime_error if v is out of order
+     */
+    void add_neighborhood(StagInt v, std::vector<stag::edge>& edges) {
+      if (v < (StagInt) offsets_.size() - 1 ||
+          v >= header_.number_of_vertices) {
+        throw std::runtime_error("Node IDs must be sorted in increasing order.");
+      }
+      while ((StagInt) offsets_.size() <= v) offsets_.push_back(offsets_.back());
+
+      if (!std::is_sorted(edges.begin(), edges.end(),
+                          [](const stag::edge& a, const stag::edge& b) {
+                            return a.v2 < b.v2;
+                          })) {
+        std::stable_sort(edges.begin(), edges.end(),
+                         [](const stag::edge& a, const stag::edge& b) {
+                           return a.v2 < b.v2;
+                         });
+      }
+
+      buffer_.clear();
+      append_varint(buffer_, edges.size());
+      StagInt previous = v;
+      for (StagUInt i = 0; i < edges.size(); i++) {
+        StagInt difference = edges[i].v2 - previous;
+        if (i == 0) {
+          append_varint(buffer_, ((uint64_t) difference << 1) ^ (uint64_t) (difference >> 63));
+        } else {
+          append_varint(buffer_, difference);
+        }
+        previous = edges[i].v2;
+      }
+      for (const stag::edge& e : edges) {
+        if (weights_ == stag::DoubleWeights) {
+          auto weight = (double) e.weight;
+          buffer_.append((const char*) &weight, sizeof(weight));
+        } else if (weights_ == stag::FloatWeights) {
+          auto weight = (float) e.weight;
+          buffer_.append((const char*) &weight, sizeof(weight));
+        }
+      }
+
+      os_.write(buffer_.data(), (std::streamsize) buffer_.size());
+      offsets_.push_back(offsets_.back() + buffer_.size());
+      header_.number_of_nonzeros += (int64_t) edges.size();
+    }
+
+    /**
+     * Write the header and the offsets, and close the file.
+     *
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void close() {
+      while ((StagInt) offsets_.size() <= header_.number_of_vertices) {
+        offsets_.push_back(offsets_.back());
+      }
+      header_.data_size = (int64_t) offsets_.back();
+      os_.seekp(0);
+      os_.write((const char*) &header_, sizeof(header_));
+      os_.write((const char*) offsets_.data(),
+                (std::streamsize) (offsets_.size() * sizeof(uint64_t)));
+      os_.close();
+      if (os_.fail()) {
+        throw std::runtime_error("Failed to write compact adjacency list file " +
+                                 filename_);
+      }
+    }
+
+  private:
+    std::string filename_;
+    std::ofstream os_;
+    stag::CompactWeights weights_;
+    CompactAdjacencyListHeader header_;
+    std::vector<uint64_t> offsets_;
+    std::string buffer_;
+};
+
+void stag::save_compact(stag::Graph& graph, std::string& filename,
+                        stag::CompactWeights weights) {
+  CompactAdjacencyListWriter writer(filename, graph.number_of_vertices(),
+                                    weights);
+  for (StagInt v = 0; v < graph.number_of_vertices(); v++) {
+    stag::NeighborView view = graph.neighbors_view(v);
+    std::vector<stag::edge> edges(view.begin(), view.end());
+    writer.add_neighborhood(v, edges);
+  }
+  writer.close();
+}
+
+void stag::adjacencylist_to_compact(std::string& adjacencylist_fname,
+                                    std::string& compact_fname,
+                                    stag::CompactWeights weights) {
+  std::ifstream is(adjacencylist_fname);
+  if (!is.is_open()) throw std::runtime_error(std::strerror(errno));
+
+  // In the first pass, find the largest node ID, which is at the start of
+  // the last content line.
+  StagInt number_of_vertices = 0;
   std::string line;
   while (stag::safeGetline(is, line)) {
     if (line[0] != '#' && line[0] != '/' && line.length() > 0) {
       try {
-        // This line of the input file isn't a comment, parse it.
-        stag::edge this_edge = parse_edgelist_content_line(line);
-        written_content = true;
-
-        // If this is a larger node than we've seen so far, begin a new
-        // line of the adjacency list file.
-        assert(this_edge.v1 >= current_node);
-        if (this_edge.v1 > current_node) {
-          os << std::endl;
-          os << this_edge.v1 << ":";
-          current_node = this_edge.v1;
-        }
+        number_of_vertices = std::max(number_of_vertices,
+                                      (StagInt) std::stoll(line) + 1);
+      } catch (std::invalid_argument &e) {
+        throw std::runtime_error("Couldn't extract ID on adjacencylist line.");
+      }
+    }
+  }
 
-        // Add the edge to the current line
-        os << " " << this_edge.v2 << ":" << this_edge.weight;
+  // In the second pass, parse and encode every neighborhood.
+  is.clear();
+  is.seekg(0);
+  CompactAdjacencyListWriter writer(compact_fname, number_of_vertices, weights);
+  while (stag::safeGetline(is, line)) {
+    if (line[0] != '#' && line[0] != '/' && line.length() > 0) {
+      try {
+        std::vector<stag::edge> neighbours =
+            stag::parse_adjacencylist_content_line(line);
+        StagInt node_id = std::stoll(line);
+        writer.add_neighborhood(node_id, neighbours);
       } catch (std::invalid_argument &e) {
         // Re-throw any parsing errors
-        throw (std::runtime_error(e.what()));
+        throw(std::runtime_error(e.what()));
       }
+    }
+  }
+  writer.close();
+}
+
+void stag::edgelist_to_compact(std::string& edgelist_fname,
+                               std::string& compact_fname,
+                               stag::CompactWeights weights) {
+  std::string temp_adjacencylist_fname = stag::getTempFilename();
+  stag::edgelist_to_adjacencylist(edgelist_fname, temp_adjacencylist_fname);
+  try {
+    stag::adjacencylist_to_compact(temp_adjacencylist_fname, compact_fname,
+                                   weights);
+  } catch (...) {
+    std::filesystem::remove(temp_adjacencylist_fname);
+    throw;
+  }
+  std::filesystem::remove(temp_adjacencylist_fname);
+}
+
+stag::CompactLocalGraph::CompactLocalGraph(const std::string& filename)
+    : file_(filename) {
+  CompactAdjacencyListHeader header = {};
+  if (file_.size() >= sizeof(header)) {
+    std::memcpy(&header, file_.data(), sizeof(header));
+  }
+  if (file_.size() < sizeof(header) ||
+      std::strncmp(header.magic, COMPACT_ADJACENCYLIST_MAGIC,
+                   sizeof(header.magic)) != 0) {
+    throw std::runtime_error(filename + " is not a STAG compact adjacency list file.");
+  }
+  if (header.version != COMPACT_ADJACENCYLIST_VERSION) {
+    throw std::runtime_error("Unsupported STAG compact adjacency list file version " +
+                             std::to_string(header.version) + ".");
+  }
+  if (header.byte_order != BINARY_GRAPH_BYTE_ORDER) {
+    throw std::runtime_error(
+        "STAG compact adjacency list file was written with a different byte order.");
+  }
+  if (header.weight_encoding > stag::NoWeights ||
+      header.number_of_vertices < 0 ||
+      header.number_of_vertices >= BINARY_GRAPH_MAX_SIZE ||
+      header.data_size < 0 ||
+      sizeof(header) + (header.number_of_vertices + 1) * sizeof(uint64_t) +
+          (StagUInt) header.data_size != file_.size()) {
+    throw std::runtime_error("STAG compact adjacency list file is corrupted.");
+  }
+
+  number_of_vertices_ = header.number_of_vertices;
+  weights_ = (stag::CompactWeights) header.weight_encoding;
+  data_size_ = header.data_size;
+
+  // The offsets follow the header, and are aligned to 8 bytes.
+  offsets_ = (const uint64_t*) (file_.data() + sizeof(header));
+  data_ = (const unsigned char*) (offsets_ + number_of_vertices_ + 1);
+  if (offsets_[number_of_vertices_] != (uint64_t) header.data_size) {
+    throw std::runtime_error("STAG compact adjacency list file is corrupted.");
+  }
+}
+
+StagInt stag::CompactLocalGraph::number_of_vertices() const {
+  return number_of_vertices_;
+}
+
+stag::CompactWeights stag::CompactLocalGraph::weights() const {
+  return weights_;
+}
+
+void stag::CompactLocalGraph::find_neighborhood(StagInt v,
+                                                const unsigned char** start,
+                                                const unsigned char** end) {
+  if (!vertex_exists(v)) {
+    throw std::runtime_error("Couldn't find node in compact adjacency list file.");
+  }
+
+  // Only the last offset is checked when the file is opened, so check the
+  // offsets of this vertex before reading its neighborhood.
+  if (offsets_[v] > offsets_[v + 1] || offsets_[v + 1] > data_size_) {
+    throw std::runtime_error("STAG compact adjacency list file is corrupted.");
+  }
+  *start = data_ + offsets_[v];
+  *end = data_ + offsets_[v + 1];
+}
+
+void stag::CompactLocalGraph::decode_neighborhood(StagInt v) {
+  const unsigned char* data;
+  const unsigned char* end;
+  find_neighborhood(v, &data, &end);
+
+  // Decode the neighbor ids. Every id takes at least one byte, which bounds
+  // the number of neighbors before any memory is allocated for them.
+  uint64_t encoded_size = read_varint(data, end);
+  if (encoded_size > (uint64_t) (end - data)) {
+    throw std::runtime_error("STAG compact adjacency list file is corrupted.");
+  }
+  auto size = (StagInt) encoded_size;
+  view_ids_buffer_.resize(size);
+  StagInt previous = v;
+  for (StagInt i = 0; i < size; i++) {
+    uint64_t difference = read_varint(data, end);
+    if (i == 0) {
+      previous += (StagInt) (difference >> 1) ^ -(StagInt) (difference & 1);
     } else {
-      if (!written_content) {
-        os << line << std::endl;
-      }
+      previous += (StagInt) difference;
     }
+    view_ids_buffer_[i] = previous;
   }
 
-  // Close the file streams
-  is.close();
-  os.close();
+  // Decode the weights.
+  if (end - data != size * compact_weight_size(weights_)) {
+    throw std::runtime_error("STAG compact adjacency list file is corrupted.");
+  }
+  view_weights_buffer_.resize(size);
+  for (StagInt i = 0; i < size; i++) {
+    if (weights_ == stag::DoubleWeights) {
+      double weight;
+      std::memcpy(&weight, data + i * sizeof(weight), sizeof(weight));
+      view_weights_buffer_[i] = weight;
+    } else if (weights_ == stag::FloatWeights) {
+      float weight;
+      std::memcpy(&weight, data + i * sizeof(weight), sizeof(weight));
+      view_weights_buffer_[i] = weight;
+    } else {
+      view_weights_buffer_[i] = 1;
+    }
+  }
+}
+
+stag::NeighborView stag::CompactLocalGraph::neighbors_view(StagInt v) {
+  decode_neighborhood(v);
+  return {v, view_ids_buffer_.data(), view_weights_buffer_.data(),
+          (StagInt) view_ids_buffer_.size()};
+}
+
+std::vector<stag::edge> stag::CompactLocalGraph::neighbors(StagInt v) {
+  stag::NeighborView view = neighbors_view(v);
+  return {view.begin(), view.end()};
+}
 
-  // Delete the temporary file
-  std::filesystem::remove(temp_edgelist_filename);
+std::vector<StagInt> stag::CompactLocalGraph::neighbors_unweighted(StagInt v) {
+  decode_neighborhood(v);
+  return view_ids_buffer_;
+}
+
+StagReal stag::CompactLocalGraph::degree(StagInt v) {
+  StagReal deg = 0;
+  for (stag::edge e : neighbors_view(v)) {
+    // Self-loops count twice towards the degree
+    if (e.v2 == v) deg += 2 * e.weight;
+    else deg += e.weight;
+  }
+  return deg;
+}
+
+StagInt stag::CompactLocalGraph::degree_unweighted(StagInt v) {
+  // The number of neighbors is at the start of the encoded neighborhood.
+  const unsigned char* data;
+  const unsigned char* end;
+  find_neighborhood(v, &data, &end);
+  uint64_t size = read_varint(data, end);
+  if (size > (uint64_t) (end - data)) {
+    throw std::runtime_error("STAG compact adjacency list file is corrupted.");
+  }
+  return (StagInt) size;
+}
+
+std::vector<StagReal> stag::CompactLocalGraph::degrees(std::vector<StagInt> vertices) {
+  std::vector<StagReal> degs;
+  degs.reserve(vertices.size());
+  for (StagInt v : vertices) degs.push_back(degree(v));
+  return degs;
+}
+
+std::vector<StagInt> stag::CompactLocalGraph::degrees_unweighted(std::vector<StagInt> vertices) {
+  std::vector<StagInt> degs;
+  degs.reserve(vertices.size());
+  for (StagInt v : vertices) degs.push_back(degree_unweighted(v));
+  return degs;
+}
+
+bool stag::CompactLocalGraph::vertex_exists(StagInt v) {
+  // Every vertex in the file has a non-empty encoded neighborhood, which
+  // begins with the number of neighbors.
+  return v >= 0 && v < number_of_vertices_ && offsets_[v + 1] != offsets_[v];
+}
+
+void stag::CompactLocalGraph::prefetch(std::span<const StagInt> vertices) {
+  for (StagInt v : vertices) {
+    if (!vertex_exists(v)) continue;
+    const unsigned char* start;
+    const unsigned char* end;
+    find_neighborhood(v, &start, &end);
+    file_.prefetch((const char*) start - file_.data(), end - start);
+  }
 }
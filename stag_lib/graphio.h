@@ -15,6 +15,7 @@
 #define STAG_TEST_GRAPHIO_H
 
 #include <string>
+#include <cstdint>
 
 #include "graph.h"
 
@@ -68,10 +69,23 @@ namespace stag {
    * \cond
    * Sort the edgelist file by the first vertex in each edge.
    *
-   * All sorting happens on disk, keeping memory requirements low.
+   * The file is parsed once, and sorted with an external merge sort. Sorted
+   * runs of at most 1 GiB of edges are written to temporary files, and then
+   * merged back into the edgelist file. Edges with the same first vertex keep
+   * their order in the file, and the comments before the first edge are kept
+   * as a header.
    */
   void sort_edgelist(std::string& filename);
 
+  /**
+   * Sort the edgelist file by the first vertex in each edge, holding at most
+   * memory_limit bytes of edges in memory, and writing the sorted runs to
+   * temporary files in the given directory. If the directory is empty, the
+   * system's temporary directory is used.
+   */
+  void sort_edgelist(std::string& filename, StagUInt memory_limit,
+                     const std::string& temp_directory);
+
   /**
    * Copy the edgelist file infile to outfile, while copying every edge to have
    * both directions.
@@ -138,6 +152,30 @@ namespace stag {
   void edgelist_to_adjacencylist(std::string& edgelist_fname,
                                  std::string& adjacencylist_fname);
 
+  /**
+   * Convert an edgelist file to an adjacency list, limiting the memory used.
+   *
+   * The edgelist file is parsed once, and both directions of every edge are
+   * sorted with an external merge sort. Sorted runs of at most half of
+   * memory_limit bytes of edges are written to temporary files in the given
+   * directory, and then merged into the adjacency list. The other half is
+   * scratch space for sorting each run.
+   * By default, the memory limit is 1 GiB and the system's temporary
+   * directory is used.
+   *
+   * @param edgelist_fname the name of the file containing the edgelist.
+   * @param adjacencylist_fname the name of the file to write the adjacencylist.
+   * @param memory_limit the maximum number of bytes of edges held in memory
+   * @param temp_directory the directory in which to write temporary files, or
+   *                       an empty string for the system's temporary directory
+   * @throws std::invalid_argument if the memory limit is zero
+   * @throws std::runtime_error if a file cannot be read or written
+   */
+  void edgelist_to_adjacencylist(std::string& edgelist_fname,
+                                 std::string& adjacencylist_fname,
+                                 StagUInt memory_limit,
+                                 const std::string& temp_directory);
+
   /**
    * Convert an adjacency list file to an edgelist.
    *
@@ -146,6 +184,319 @@ namespace stag {
    */
   void adjacencylist_to_edgelist(std::string& adjacencylist_fname,
                                  std::string& edgelist_fname);
+
+  /**
+   * Save the given graph as a STAG binary graph file.
+   *
+   * The binary file stores the compressed sparse adjacency matrix of the
+   * graph exactly as it is stored in memory, so that it can be loaded without
+   * parsing. The file can be read with stag::load_binary, or opened without
+   * reading it into memory with stag::MappedGraph.
+   *
+   * The file format is defined in [Graph File Formats](@ref file-formats).
+   * Binary files use the byte order of the machine on which they are written.
+   *
+   * @param graph the graph object to be saved
+   * @param filename the name of the file to save the graph to
+   * @throws std::runtime_error if the file cannot be written
+   */
+  void save_binary(stag::Graph& graph, std::string& filename);
+
+  /**
+   * Load a graph from a STAG binary graph file, created by
+   * stag::save_binary.
+   *
+   * @param filename the name of the binary file to be loaded
+   * @return stag::Graph object
+   * @throws std::runtime_error if the file doesn't exist or is not a valid
+   *         STAG binary graph file
+   */
+  stag::Graph load_binary(std::string& filename);
+
+  /**
+   * \brief A read-only graph backed by a memory-mapped STAG binary graph file.
+   *
+   * Opening a binary file with this class takes constant time, regardless
+   * of the size of the graph. The file is mapped into memory, and the
+   * operating system reads each part of the file from disk when it is first
+   * accessed. The neighborhoods returned by stag::MappedGraph::neighbors_view
+   * point directly into the mapped file, and the memory used is shared by
+   * every process which opens the same file.
+   *
+   * \code{.cpp}
+   *     #include <stag/graph.h>
+   *     #include <stag/graphio.h>
+   *     #include <stag/cluster.h>
+   *
+   *     int main() {
+   *       std::string filename = "mygraph.bin";
+   *       stag::Graph myGraph = stag::barbell_graph(10);
+   *       stag::save_binary(myGraph, filename);
+   *
+   *       // Open the graph without reading it into memory
+   *       stag::MappedGraph mappedGraph(filename);
+   *       std::vector<StagInt> cluster = stag::local_cluster(&mappedGraph, 0, 50);
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   *
+   * The binary file must not be modified while it is open.
+   */
+  class MappedGraph : public LocalGraph {
+  public:
+    /**
+     * Open a STAG binary graph file.
+     *
+     * Only the header of the file, and the ends of its arrays, are checked
+     * when it is opened. The neighbors of each vertex are checked when they
+     * are used.
+     *
+     * @param filename the name of the binary file, created by stag::save_binary
+     * @throws std::runtime_error if the file doesn't exist or is not a valid
+     *         STAG binary graph file
+     */
+    explicit MappedGraph(const std::string& filename);
+
+    /**
+     * The number of vertices in the graph.
+     */
+    StagInt number_of_vertices() const;
+
+    /**
+     * The number of edges in the graph.
+     */
+    StagInt number_of_edges() const;
+
+    /**
+     * The adjacency matrix of the graph, which refers directly to the data in
+     * the mapped file.
+     *
+     * The arrays of the matrix are checked before it is returned, which
+     * reads them in full.
+     *
+     * @return an Eigen::Map of the sparse adjacency matrix, which is valid for
+     *         the lifetime of this object
+     * @throws std::runtime_error if the arrays in the file are corrupted
+     */
+    Eigen::Map<const SprsMat> adjacency() const;
+
+    /**
+     * Construct a stag::Graph object with the same edges as this graph, by
+     * copying the adjacency matrix into memory.
+     *
+     * @return a new stag::Graph object
+     * @throws std::runtime_error if the arrays in the file are corrupted
+     */
+    Graph to_graph() const;
+
+    // Override the abstract methods in the LocalGraph base class.
+    StagReal degree(StagInt v) override;
+    StagInt degree_unweighted(StagInt v) override;
+    std::vector<edge> neighbors(StagInt v) override;
+    std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+    NeighborView neighbors_view(StagInt v) override;
+    std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
+    std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
+    bool vertex_exists(StagInt v) override;
+    void prefetch(std::span<const StagInt> vertices) override;
+    ~MappedGraph() override = default;
+
+  private:
+    /**
+     * Check the validity of a method argument which is supposed to refer
+     * to a vertex in the graph.
+     *
+     * @throws std::invalid_argument if the check does not pass
+     */
+    void check_vertex_argument(StagInt v) const;
+
+    /**
+     * Check that the neighbors of the given vertex lie inside the arrays of
+     * the file.
+     *
+     * @throws std::runtime_error if the check does not pass
+     */
+    void check_neighbors_range(StagInt v) const;
+
+    // The mapped binary file.
+    MappedFile file_;
+
+    // The number of vertices, edges, and non-zero entries of the adjacency
+    // matrix, read from the header of the file.
+    StagInt number_of_vertices_;
+    StagInt number_of_edges_;
+    StagInt number_of_nonzeros_;
+
+    // Pointers to the arrays stored in the mapped file.
+    const StagInt* outer_starts_;
+    const StagInt* inner_indices_;
+    const StagReal* values_;
+    const StagReal* degrees_;
+  };
+
+  /**
+   * The precision with which the edge weights are stored in a compact
+   * adjacency list file.
+   *
+   *   - DoubleWeights: each weight is stored exactly, in 8 bytes.
+   *   - FloatWeights: each weight is rounded to a single-precision float,
+   *     and stored in 4 bytes.
+   *   - NoWeights: the weights are not stored, and every edge is read with
+   *     weight 1.
+   */
+  enum CompactWeights {DoubleWeights, FloatWeights, NoWeights};
+
+  /**
+   * Save the given graph as a compact adjacency list file.
+   *
+   * The compact adjacency list format stores the neighbors of each vertex
+   * with a variable-length encoding, and is faster to read than the text
+   * adjacency list format. The neighbor IDs are much smaller than in the text
+   * format, but by default every weight is stored exactly in 8 bytes, which
+   * can be larger than its text form. Storing the weights as FloatWeights,
+   * or omitting them with NoWeights, gives a much smaller file. The file can
+   * be read with stag::CompactLocalGraph.
+   *
+   * The file format is defined in [Graph File Formats](@ref file-formats).
+   *
+   * @param graph the graph object to be saved
+   * @param filename the name of the file to save the graph to
+   * @param weights the precision with which to store the edge weights
+   * @throws std::runtime_error if the file cannot be written
+   */
+  void save_compact(stag::Graph& graph, std::string& filename,
+                    CompactWeights weights = DoubleWeights);
+
+  /**
+   * Convert an adjacency list file to a compact adjacency list file.
+   *
+   * The adjacency list file is read twice, and is never loaded into memory
+   * at once.
+   *
+   * @param adjacencylist_fname the name of the file containing the adjacency list.
+   * @param compact_fname the name of the compact adjacency list file to write.
+   * @param weights the precision with which to store the edge weights
+   * @throws std::runtime_error if the adjacency list cannot be parsed, its
+   *         node IDs are not sorted, or the file cannot be written
+   */
+  void adjacencylist_to_compact(std::string& adjacencylist_fname,
+                                std::string& compact_fname,
+                                CompactWeights weights = DoubleWeights);
+
+  /**
+   * Convert an edgelist file to a compact adjacency list file.
+   *
+   * The edgelist is first converted to a temporary adjacency list file with
+   * stag::edgelist_to_adjacencylist.
+   *
+   * @param edgelist_fname the name of the file containing the edgelist.
+   * @param compact_fname the name of the compact adjacency list file to write.
+   * @param weights the precision with which to store the edge weights
+   * @throws std::runtime_error if the edgelist cannot be parsed, or the file
+   *         cannot be written
+   */
+  void edgelist_to_compact(std::string& edgelist_fname,
+                           std::string& compact_fname,
+                           CompactWeights weights = DoubleWeights);
+
+  /**
+   * \brief A local graph backed by a compact adjacency list file.
+   *
+   * The file is mapped into memory, and the neighborhood of a vertex is
+   * decoded when it is queried. Since the offset of every neighborhood is
+   * stored in the file, opening the file takes constant time, and no index
+   * needs to be built.
+   *
+   * \code{.cpp}
+   *     #include <stag/graph.h>
+   *     #include <stag/graphio.h>
+   *     #include <stag/cluster.h>
+   *
+   *     int main() {
+   *       std::string adjacencylist_fname = "mygraph.adjacencylist";
+   *       std::string compact_fname = "mygraph.cadj";
+   *       stag::adjacencylist_to_compact(adjacencylist_fname, compact_fname);
+   *
+   *       stag::CompactLocalGraph graph(compact_fname);
+   *       std::vector<StagInt> cluster = stag::local_cluster(&graph, 0, 50);
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   *
+   * The views returned by neighbors_view are valid until the next call to a
+   * non-const method of this object.
+   * The compact adjacency list file must not be modified while it is open.
+   */
+  class CompactLocalGraph : public LocalGraph {
+  public:
+    /**
+     * Open a compact adjacency list file.
+     *
+     * @param filename the name of the compact adjacency list file
+     * @throws std::runtime_error if the file doesn't exist or is not a valid
+     *         compact adjacency list file
+     */
+    explicit CompactLocalGraph(const std::string& filename);
+
+    /**
+     * One more than the largest vertex ID in the file.
+     */
+    StagInt number_of_vertices() const;
+
+    /**
+     * The precision with which the edge weights are stored in the file.
+     */
+    CompactWeights weights() const;
+
+    // Override the abstract methods in the LocalGraph base class.
+    StagReal degree(StagInt v) override;
+    StagInt degree_unweighted(StagInt v) override;
+    std::vector<edge> neighbors(StagInt v) override;
+    std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+    NeighborView neighbors_view(StagInt v) override;
+    std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
+    std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
+    bool vertex_exists(StagInt v) override;
+    void prefetch(std::span<const StagInt> vertices) override;
+    ~CompactLocalGraph() override = default;
+
+  private:
+    /**
+     * Find the encoded neighborhood of v in the data section of the file.
+     *
+     * @param v the vertex to find
+     * @param start set to the start of the encoded neighborhood
+     * @param end set to the end of the encoded neighborhood
+     * @throws std::runtime_error if the vertex is not in the file, or its
+     *         offsets are corrupted
+     */
+    void find_neighborhood(StagInt v, const unsigned char** start,
+                           const unsigned char** end);
+
+    /**
+     * Decode the neighborhood of v into the buffers owned by the LocalGraph
+     * base class.
+     *
+     * @throws std::runtime_error if the encoded neighborhood is corrupted
+     */
+    void decode_neighborhood(StagInt v);
+
+    // The mapped compact adjacency list file.
+    MappedFile file_;
+
+    // The number of vertices and the weight encoding, read from the header
+    // of the file.
+    StagInt number_of_vertices_;
+    CompactWeights weights_;
+
+    // The offset of the encoded neighborhood of each vertex, relative to the
+    // start of the data section of the file.
+    const uint64_t* offsets_;
+    const unsigned char* data_;
+    uint64_t data_size_;
+  };
 }
 
 #endif //STAG_TEST_GRAPHIO_H
\ No newline at end of file
@@ -0,0 +1,525 @@
+/*
+   This file is provided as part of the STAG library and released under the GPL
+   license.
+*/
+// Standard C++ libraries
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// STAG modules
+#include "graphserver.h"
+
+//------------------------------------------------------------------------------
+// Protocol
+//------------------------------------------------------------------------------
+// Each query is a RequestHeader followed by the count vertex IDs. The
+// response contains one entry for each vertex:
+//   - GRAPH_SERVER_NEIGHBORS: the number of neighbors s, followed by the s
+//     neighbor IDs, the s edge weights, the unweighted degree and the
+//     weighted degree.
+//   - GRAPH_SERVER_DEGREES: the unweighted degree, followed by the weighted
+//     degree.
+//   - GRAPH_SERVER_EXISTS: 1 if the vertex exists, and 0 otherwise.
+// A vertex which is not in the graph has a number of neighbors, or an
+// unweighted degree, of -1. Every value is 8 bytes long, and is stored in the
+// byte order of the machine.
+#define GRAPH_SERVER_NEIGHBORS 1
+#define GRAPH_SERVER_DEGREES 2
+#define GRAPH_SERVER_EXISTS 3
+
+// The largest number of vertices in one query. Larger batches are split into
+// several queries by the client, and a client which sends a larger query is
+// disconnected.
+#define GRAPH_SERVER_MAX_BATCH ((int64_t) 1 << 20)
+
+// The approximate number of bytes used by the degrees of one vertex in the
+// cache of a RemoteLocalGraph, including the list and hash table nodes.
+#define DEGREE_CACHE_ENTRY_BYTES 96
+
+struct RequestHeader {
+  uint32_t type;
+  uint32_t reserved;
+  int64_t count;
+};
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+#ifndef _WIN32
+/**
+ * Write the whole buffer to the socket.
+ *
+ * @return false if the connection was closed
+ */
+bool send_all(int fd, const void* data, StagUInt bytes) {
+  auto buffer = (const char*) data;
+  while (bytes > 0) {
+    ssize_t sent = send(fd, buffer, bytes, SEND_FLAGS);
+    if (sent < 0 && errno == EINTR) continue;
+    if (sent <= 0) return false;
+    buffer += sent;
+    bytes -= sent;
+  }
+  return true;
+}
+
+/**
+ * Read exactly the given number of bytes from the socket.
+ *
+ * @return false if the connection was closed
+ */
+bool receive_all(int fd, void* data, StagUInt bytes) {
+  auto buffer = (char*) data;
+  while (bytes > 0) {
+    ssize_t received = recv(fd, buffer, bytes, 0);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) return false;
+    buffer += received;
+    bytes -= received;
+  }
+  return true;
+}
+
+/**
+ * The address of the Unix domain socket with the given path.
+ *
+ * @throws std::runtime_error if the path is too long
+ */
+sockaddr_un socket_address(const std::string& socket_path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("Socket path is too long: " + socket_path);
+  }
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+  return address;
+}
+#endif
+
+/**
+ * Append a value to the buffer.
+ */
+template <typename T>
+void append_value(std::string& buffer, T value) {
+  buffer.append((const char*) &value, sizeof(value));
+}
+
+//------------------------------------------------------------------------------
+// Graph Server
+//------------------------------------------------------------------------------
+#ifdef _WIN32
+stag::GraphServer::GraphServer(LocalGraph* graph, const std::string& socket_path)
+    : graph_(graph), socket_path_(socket_path) {
+  throw std::runtime_error("The graph server is not supported on Windows.");
+}
+
+stag::GraphServer::~GraphServer() = default;
+
+void stag::GraphServer::serve() {}
+
+void stag::GraphServer::stop() {}
+
+void stag::GraphServer::serve_client(int /* client_fd */) {}
+
+void stag::GraphServer::append_response(uint32_t /* type */, StagInt /* v */,
+                                        std::string& /* response */) {}
+#else
+stag::GraphServer::GraphServer(LocalGraph* graph, const std::string& socket_path)
+    : graph_(graph), socket_path_(socket_path) {
+  sockaddr_un address = socket_address(socket_path);
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+
+  // Replace any socket left behind by a previous server.
+  unlink(socket_path.c_str());
+  if (bind(listen_fd_, (sockaddr*) &address, sizeof(address)) != 0 ||
+      listen(listen_fd_, SOMAXCONN) != 0) {
+    std::string error = std::strerror(errno);
+    close(listen_fd_);
+    throw std::runtime_error("Couldn't listen on socket " + socket_path +
+                             ": " + error);
+  }
+}
+
+stag::GraphServer::~GraphServer() {
+  stop();
+  std::unique_lock<std::mutex> lock(clients_mutex_);
+  clients_finished_.wait(lock, [this]() { return active_clients_ == 0; });
+  close(listen_fd_);
+  unlink(socket_path_.c_str());
+}
+
+void stag::GraphServer::serve() {
+  while (!stopped_) {
+    int client_fd = accept(listen_fd_, nullptr, nullptr);
+    if (client_fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      break;
+    }
+
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    if (stopped_) {
+      close(client_fd);
+      break;
+    }
+    client_fds_.push_back(client_fd);
+    active_clients_++;
+    std::thread(&GraphServer::serve_client, this, client_fd).detach();
+  }
+}
+
+void stag::GraphServer::stop() {
+  // Shutting down the sockets wakes up the threads waiting on them.
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  stopped_ = true;
+  shutdown(listen_fd_, SHUT_RDWR);
+  for (int client_fd : client_fds_) shutdown(client_fd, SHUT_RDWR);
+}
+
+void stag::GraphServer::append_response(uint32_t type, StagInt v,
+                                        std::string& response) {
+  // A vertex whose neighborhood cannot be read is reported as missing.
+  try {
+    if (type == GRAPH_SERVER_EXISTS) {
+      append_value<int64_t>(response, graph_->vertex_exists(v) ? 1 : 0);
+    } else if (!graph_->vertex_exists(v)) {
+      throw std::invalid_argument("Vertex is not in the graph.");
+    } else if (type == GRAPH_SERVER_NEIGHBORS) {
+      // The degrees are sent with the neighborhood, so that the client
+      // caches the same degrees as it would receive for a degree query.
+      // They are found first, since they may invalidate the view.
+      StagInt unweighted = graph_->degree_unweighted(v);
+      StagReal weighted = graph_->degree(v);
+      stag::NeighborView view = graph_->neighbors_view(v);
+      append_value<int64_t>(response, view.size());
+      for (StagInt u : view.ids()) append_value<int64_t>(response, u);
+      for (StagReal w : view.weights()) append_value<double>(response, w);
+      append_value<int64_t>(response, unweighted);
+      append_value<double>(response, weighted);
+    } else {
+      StagInt unweighted = graph_->degree_unweighted(v);
+      StagReal weighted = graph_->degree(v);
+      append_value<int64_t>(response, unweighted);
+      append_value<double>(response, weighted);
+    }
+  } catch (std::exception& e) {
+    append_value<int64_t>(response, type == GRAPH_SERVER_EXISTS ? 0 : -1);
+    if (type == GRAPH_SERVER_DEGREES) append_value<double>(response, 0);
+  }
+}
+
+void stag::GraphServer::serve_client(int client_fd) {
+  // The client thread is detached, so any error, such as running out of
+  // memory for a response, only disconnects this client.
+  try {
+    RequestHeader header;
+    std::vector<StagInt> vertices;
+    std::string response;
+    while (receive_all(client_fd, &header, sizeof(header))) {
+      if (header.type < GRAPH_SERVER_NEIGHBORS || header.type > GRAPH_SERVER_EXISTS ||
+          header.count < 0 || header.count > GRAPH_SERVER_MAX_BATCH) {
+        break;
+      }
+      vertices.resize(header.count);
+      if (!receive_all(client_fd, vertices.data(),
+                       vertices.size() * sizeof(StagInt))) {
+        break;
+      }
+
+      // Build the response while holding the lock on the graph.
+      response.clear();
+      {
+        std::lock_guard<std::mutex> lock(graph_mutex_);
+        for (StagInt v : vertices) {
+          append_response(header.type, v, response);
+        }
+      }
+
+      if (!send_all(client_fd, response.data(), response.size())) break;
+    }
+  } catch (std::exception& e) {
+    // Drop the connection.
+  }
+
+  // Forget the client once it disconnects.
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  client_fds_.erase(std::find(client_fds_.begin(), client_fds_.end(),
+                              client_fd));
+  close(client_fd);
+  active_clients_--;
+  clients_finished_.notify_all();
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Remote Local Graph
+//------------------------------------------------------------------------------
+stag::RemoteLocalGraph::RemoteLocalGraph(const std::string& socket_path) {
+#ifdef _WIN32
+  throw std::runtime_error("The graph server is not supported on Windows.");
+#else
+  sockaddr_un address = socket_address(socket_path);
+  fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd_ < 0) {
+    throw std::runtime_error(std::strerror(errno));
+  }
+  if (connect(fd_, (sockaddr*) &address, sizeof(address)) != 0) {
+    std::string error = std::strerror(errno);
+    close(fd_);
+    throw std::runtime_error("Couldn't connect to graph server at " +
+                             socket_path + ": " + error);
+  }
+#endif
+}
+
+stag::RemoteLocalGraph::~RemoteLocalGraph() {
+#ifndef _WIN32
+  if (fd_ >= 0) close(fd_);
+#endif
+}
+
+void stag::RemoteLocalGraph::set_cache_budget(StagUInt bytes) {
+  cache_.set_budget(bytes);
+  evict_degrees();
+}
+
+StagUInt stag::RemoteLocalGraph::cache_budget() const {
+  return cache_.budget();
+}
+
+stag::NeighborhoodCacheStats stag::RemoteLocalGraph::cache_stats() const {
+  return cache_.stats();
+}
+
+void stag::RemoteLocalGraph::clear_cache() {
+  cache_.clear();
+  degree_order_.clear();
+  degree_cache_.clear();
+}
+
+bool stag::RemoteLocalGraph::find_degrees(StagInt v, VertexDegrees* degrees) {
+  auto it = degree_cache_.find(v);
+  if (it == degree_cache_.end()) return false;
+  degree_order_.splice(degree_order_.begin(), degree_order_, it->second);
+  *degrees = it->second->second;
+  return true;
+}
+
+void stag::RemoteLocalGraph::cache_degrees(StagInt v, VertexDegrees degrees) {
+  auto it = degree_cache_.find(v);
+  if (it != degree_cache_.end()) {
+    degree_order_.splice(degree_order_.begin(), degree_order_, it->second);
+    it->second->second = degrees;
+    return;
+  }
+  degree_order_.emplace_front(v, degrees);
+  degree_cache_[v] = degree_order_.begin();
+  evict_degrees();
+}
+
+void stag::RemoteLocalGraph::evict_degrees() {
+  while (!degree_order_.empty() &&
+         degree_order_.size() * DEGREE_CACHE_ENTRY_BYTES > cache_.budget()) {
+    degree_cache_.erase(degree_order_.back().first);
+    degree_order_.pop_back();
+  }
+}
+
+StagUInt stag::RemoteLocalGraph::number_of_requests() const {
+  return requests_;
+}
+
+void stag::RemoteLocalGraph::send_request(uint32_t type,
+                                          const std::vector<StagInt>& vertices) {
+#ifndef _WIN32
+  RequestHeader header = {type, 0, (int64_t) vertices.size()};
+  if (!send_all(fd_, &header, sizeof(header)) ||
+      !send_all(fd_, vertices.data(), vertices.size() * sizeof(StagInt))) {
+    throw std::runtime_error("Lost connection to graph server.");
+  }
+  requests_++;
+#endif
+}
+
+void stag::RemoteLocalGraph::receive(void* data, StagUInt bytes) {
+#ifndef _WIN32
+  if (!receive_all(fd_, data, bytes)) {
+    throw std::runtime_error("Lost connection to graph server.");
+  }
+#endif
+}
+
+bool stag::RemoteLocalGraph::receive_neighborhood(StagInt v,
+                                                  NeighborView* view) {
+  int64_t size;
+  receive(&size, sizeof(size));
+  if (size < 0) return false;
+
+  std::vector<StagInt> ids(size);
+  std::vector<StagReal> weights(size);
+  int64_t unweighted;
+  double weighted;
+  receive(ids.data(), size * sizeof(StagInt));
+  receive(weights.data(), size * sizeof(StagReal));
+  receive(&unweighted, sizeof(unweighted));
+  receive(&weighted, sizeof(weighted));
+
+  std::vector<stag::edge> edges;
+  edges.reserve(size);
+  for (StagInt i = 0; i < size; i++) edges.push_back({v, ids[i], weights[i]});
+  *view = cache_.insert(v, edges);
+  cache_degrees(v, {weighted, unweighted});
+  return true;
+}
+
+bool stag::RemoteLocalGraph::fetch_neighborhoods(const std::vector<StagInt>& vertices) {
+  // Large batches are split into several queries, to stay within the limit of
+  // the server.
+  bool found = true;
+  for (StagUInt first = 0; first < vertices.size(); first += GRAPH_SERVER_MAX_BATCH) {
+    std::vector<StagInt> batch(
+        vertices.begin() + first,
+        vertices.begin() + MIN(first + GRAPH_SERVER_MAX_BATCH, vertices.size()));
+    send_request(GRAPH_SERVER_NEIGHBORS, batch);
+
+    // Read the whole response, even if a vertex is missing, so that the
+    // connection can be used again.
+    stag::NeighborView view;
+    for (StagInt v : batch) {
+      if (!receive_neighborhood(v, &view)) found = false;
+    }
+  }
+  return found;
+}
+
+std::vector<stag::RemoteLocalGraph::VertexDegrees>
+stag::RemoteLocalGraph::lookup_degrees(const std::vector<StagInt>& vertices) {
+  // Find the vertices whose degrees are not cached.
+  std::vector<VertexDegrees> degs(vertices.size());
+  std::vector<bool> is_missing(vertices.size(), false);
+  std::vector<StagInt> missing;
+  for (StagUInt i = 0; i < vertices.size(); i++) {
+    if (!find_degrees(vertices[i], &degs[i])) {
+      is_missing[i] = true;
+      missing.push_back(vertices[i]);
+    }
+  }
+  std::sort(missing.begin(), missing.end());
+  missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+  // Fetch them from the server in one round trip, unless there are too many
+  // for a single query. The fetched degrees are kept until they are returned,
+  // since they may be evicted from the cache.
+  std::unordered_map<StagInt, VertexDegrees> fetched;
+  bool not_found = false;
+  for (StagUInt first = 0; first < missing.size(); first += GRAPH_SERVER_MAX_BATCH) {
+    std::vector<StagInt> batch(
+        missing.begin() + first,
+        missing.begin() + MIN(first + GRAPH_SERVER_MAX_BATCH, missing.size()));
+    send_request(GRAPH_SERVER_DEGREES, batch);
+    for (StagInt v : batch) {
+      int64_t unweighted;
+      double weighted;
+      receive(&unweighted, sizeof(unweighted));
+      receive(&weighted, sizeof(weighted));
+      if (unweighted < 0) {
+        not_found = true;
+      } else {
+        fetched[v] = {weighted, unweighted};
+        cache_degrees(v, {weighted, unweighted});
+      }
+    }
+  }
+  if (not_found) {
+    throw std::runtime_error("Couldn't find node on graph server.");
+  }
+
+  for (StagUInt i = 0; i < vertices.size(); i++) {
+    if (is_missing[i]) degs[i] = fetched.at(vertices[i]);
+  }
+  return degs;
+}
+
+stag::NeighborView stag::RemoteLocalGraph::neighbors_view(StagInt v) {
+  // The view points into the cache, and remains valid until another
+  // neighborhood is received.
+  stag::NeighborView view;
+  if (cache_.lookup(v, &view)) return view;
+
+  send_request(GRAPH_SERVER_NEIGHBORS, {v});
+  if (!receive_neighborhood(v, &view)) {
+    throw std::runtime_error("Couldn't find node on graph server.");
+  }
+  return view;
+}
+
+std::vector<stag::edge> stag::RemoteLocalGraph::neighbors(StagInt v) {
+  stag::NeighborView view = neighbors_view(v);
+  return {view.begin(), view.end()};
+}
+
+std::vector<StagInt> stag::RemoteLocalGraph::neighbors_unweighted(StagInt v) {
+  std::span<const StagInt> ids = neighbors_view(v).ids();
+  return {ids.begin(), ids.end()};
+}
+
+StagReal stag::RemoteLocalGraph::degree(StagInt v) {
+  return lookup_degrees({v})[0].weighted;
+}
+
+StagInt stag::RemoteLocalGraph::degree_unweighted(StagInt v) {
+  return lookup_degrees({v})[0].unweighted;
+}
+
+std::vector<StagReal> stag::RemoteLocalGraph::degrees(std::vector<StagInt> vertices) {
+  std::vector<StagReal> degs;
+  degs.reserve(vertices.size());
+  for (VertexDegrees d : lookup_degrees(vertices)) degs.push_back(d.weighted);
+  return degs;
+}
+
+std::vector<StagInt> stag::RemoteLocalGraph::degrees_unweighted(std::vector<StagInt> vertices) {
+  std::vector<StagInt> degs;
+  degs.reserve(vertices.size());
+  for (VertexDegrees d : lookup_degrees(vertices)) degs.push_back(d.unweighted);
+  return degs;
+}
+
+bool stag::RemoteLocalGraph::vertex_exists(StagInt v) {
+  if (degree_cache_.contains(v)) return true;
+
+  send_request(GRAPH_SERVER_EXISTS, {v});
+  int64_t exists;
+  receive(&exists, sizeof(exists));
+  return exists != 0;
+}
+
+void stag::RemoteLocalGraph::prefetch(std::span<const StagInt> vertices) {
+  // Fetch every uncached neighborhood in one round trip.
+  std::vector<StagInt> uncached;
+  for (StagInt v : vertices) {
+    if (!cache_.contains(v)) uncached.push_back(v);
+  }
+  std::sort(uncached.begin(), uncached.end());
+  uncached.erase(std::unique(uncached.begin(), uncached.end()), uncached.end());
+  if (uncached.empty()) return;
+
+  // The hint may include vertices which are not in the graph, which are
+  // ignored.
+  fetch_neighborhoods(uncached);
+}
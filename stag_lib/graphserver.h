@@ -0,0 +1,289 @@
+/*
+   This file is provided as part of the STAG library and released under the GPL
+   license.
+*/
+
+/**
+ * @file graphserver.h
+ * \brief Sharing one copy of a graph between several processes.
+ *
+ * A stag::GraphServer holds a local graph and answers queries about it from
+ * other processes on the same machine, over a Unix domain socket. Each
+ * process queries the graph through a stag::RemoteLocalGraph, which can be
+ * passed to any local algorithm, such as stag::local_cluster. This allows
+ * many short-lived processes to use a huge graph without each of them
+ * loading it from disk.
+ *
+ * \code{.cpp}
+ *     #include <stag/graph.h>
+ *     #include <stag/cluster.h>
+ *     #include <stag/graphserver.h>
+ *
+ *     int main() {
+ *       // Connect to a server started with
+ *       //   stag_graphserver mygraph.adjacencylist /tmp/mygraph.sock
+ *       stag::RemoteLocalGraph graph("/tmp/mygraph.sock");
+ *       std::vector<StagInt> cluster = stag::local_cluster(&graph, 0, 100);
+ *
+ *       return 0;
+ *     }
+ * \endcode
+ *
+ * Unix domain sockets are not supported on Windows.
+ */
+
+#ifndef STAG_LIBRARY_GRAPHSERVER_H
+#define STAG_LIBRARY_GRAPHSERVER_H
+
+#include <string>
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_map>
+#include <list>
+
+#include "definitions.h"
+#include "graph.h"
+
+namespace stag {
+
+  /**
+   * \brief A server which answers queries about a local graph from other
+   * processes, over a Unix domain socket.
+   *
+   * Each query asks for the neighborhoods, the degrees, or the existence of
+   * a batch of vertices, and is answered in a single round trip.
+   * Every connected client is served by its own thread, and the queries are
+   * passed to the graph one at a time, so any stag::LocalGraph may be
+   * served, including a stag::AdjacencyListLocalGraph.
+   *
+   * \code{.cpp}
+   *     #include <stag/graph.h>
+   *     #include <stag/graphserver.h>
+   *
+   *     int main() {
+   *       stag::AdjacencyListLocalGraph graph("mygraph.adjacencylist");
+   *       stag::GraphServer server(&graph, "/tmp/mygraph.sock");
+   *       server.serve();
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   */
+  class GraphServer {
+  public:
+    /**
+     * Create a server for the given graph, listening on a Unix domain socket
+     * with the given path.
+     *
+     * Any existing file at the socket path is replaced. The graph must
+     * outlive the server.
+     *
+     * @param graph the graph to be served
+     * @param socket_path the path of the socket to listen on
+     * @throws std::runtime_error if the socket cannot be created
+     */
+    GraphServer(LocalGraph* graph, const std::string& socket_path);
+
+    GraphServer(const GraphServer& other) = delete;
+    GraphServer& operator=(const GraphServer& other) = delete;
+
+    /**
+     * Stop the server, and remove the socket file.
+     */
+    ~GraphServer();
+
+    /**
+     * Accept clients and answer their queries, until stop is called.
+     */
+    void serve();
+
+    /**
+     * Stop accepting clients, disconnect every client, and return from
+     * serve.
+     *
+     * This method may be called from any thread.
+     */
+    void stop();
+
+  private:
+    /**
+     * Answer the queries of one client, until the client disconnects.
+     */
+    void serve_client(int client_fd);
+
+    /**
+     * Append the answer to a query about the vertex v to the response.
+     */
+    void append_response(uint32_t type, StagInt v, std::string& response);
+
+    LocalGraph* graph_;
+    std::string socket_path_;
+    int listen_fd_ = -1;
+
+    // Queries are passed to the graph one at a time.
+    std::mutex graph_mutex_;
+
+    // The connected clients. Each client is served by a detached thread,
+    // and the server waits for them to finish when it is destroyed.
+    std::mutex clients_mutex_;
+    std::condition_variable clients_finished_;
+    std::vector<int> client_fds_;
+    StagInt active_clients_ = 0;
+    std::atomic<bool> stopped_ = false;
+  };
+
+  /**
+   * \brief A local graph whose neighborhoods are read from a
+   * stag::GraphServer running in another process.
+   *
+   * The neighborhoods received from the server are kept in a cache, with a
+   * configurable budget, and the degrees received from the server are kept
+   * in a second cache with the same budget.
+   * The vertices passed to stag::LocalGraph::prefetch are fetched from the
+   * server in a single round trip, and so the local algorithms which issue
+   * prefetch hints, such as stag::approximate_pagerank, request a whole
+   * frontier at a time.
+   *
+   * A RemoteLocalGraph object must not be used by several threads at once.
+   * The views returned by neighbors_view are valid until the next
+   * neighborhood is received from the server.
+   */
+  class RemoteLocalGraph : public LocalGraph {
+  public:
+    /**
+     * Connect to the graph server listening on the given socket.
+     *
+     * @param socket_path the path of the socket of the server
+     * @throws std::runtime_error if the server cannot be reached
+     */
+    explicit RemoteLocalGraph(const std::string& socket_path);
+
+    RemoteLocalGraph(const RemoteLocalGraph& other) = delete;
+    RemoteLocalGraph& operator=(const RemoteLocalGraph& other) = delete;
+
+    /**
+     * Set the maximum number of bytes used to cache neighbourhoods, and the
+     * maximum number of bytes used to cache degrees.
+     *
+     * See stag::AdjacencyListLocalGraph::set_cache_budget. The least
+     * recently used degrees are evicted in the same way as neighborhoods.
+     *
+     * @param bytes the maximum number of bytes used by each cache
+     */
+    void set_cache_budget(StagUInt bytes);
+
+    /**
+     * The maximum number of bytes used by each cache. By default, this is
+     * unlimited.
+     */
+    StagUInt cache_budget() const;
+
+    /**
+     * The hit, miss and eviction counters of the neighbourhood cache.
+     */
+    NeighborhoodCacheStats cache_stats() const;
+
+    /**
+     * Discard every cached neighbourhood and degree.
+     */
+    void clear_cache();
+
+    /**
+     * The number of queries sent to the server so far.
+     */
+    StagUInt number_of_requests() const;
+
+    // Override the abstract methods in the LocalGraph base class.
+    StagReal degree(StagInt v) override;
+    StagInt degree_unweighted(StagInt v) override;
+    std::vector<edge> neighbors(StagInt v) override;
+    std::vector<StagInt> neighbors_unweighted(StagInt v) override;
+    NeighborView neighbors_view(StagInt v) override;
+    std::vector<StagReal> degrees(std::vector<StagInt> vertices) override;
+    std::vector<StagInt> degrees_unweighted(std::vector<StagInt> vertices) override;
+    bool vertex_exists(StagInt v) override;
+    void prefetch(std::span<const StagInt> vertices) override;
+    ~RemoteLocalGraph() override;
+
+  private:
+    /**
+     * The weighted and unweighted degrees of a vertex.
+     */
+    struct VertexDegrees {
+      StagReal weighted;
+      StagInt unweighted;
+    };
+
+    /**
+     * Fetch the neighborhoods of the given vertices from the server in one
+     * round trip, and add them to the cache.
+     *
+     * @return whether every vertex is in the graph
+     */
+    bool fetch_neighborhoods(const std::vector<StagInt>& vertices);
+
+    /**
+     * Read the neighborhood and degrees of v in the response to a query, and
+     * add them to the cache.
+     *
+     * @return whether v is in the graph
+     */
+    bool receive_neighborhood(StagInt v, NeighborView* view);
+
+    /**
+     * Return the degrees of the given vertices, fetching the degrees which
+     * are not cached from the server in one round trip.
+     *
+     * @throws std::runtime_error if any of the vertices is not in the graph
+     */
+    std::vector<VertexDegrees> lookup_degrees(const std::vector<StagInt>& vertices);
+
+    /**
+     * If the degrees of v are cached, mark them as the most recently used
+     * and copy them into degrees.
+     *
+     * @return whether the degrees of v are cached
+     */
+    bool find_degrees(StagInt v, VertexDegrees* degrees);
+
+    /**
+     * Add the degrees of v to the cache, evicting the least recently used
+     * degrees if the cache is over its budget.
+     */
+    void cache_degrees(StagInt v, VertexDegrees degrees);
+
+    /**
+     * Evict the least recently used degrees until the cache is within its
+     * budget.
+     */
+    void evict_degrees();
+
+    /**
+     * Send a query to the server.
+     */
+    void send_request(uint32_t type, const std::vector<StagInt>& vertices);
+
+    /**
+     * Read part of the response to a query from the server.
+     */
+    void receive(void* data, StagUInt bytes);
+
+    int fd_ = -1;
+    StagUInt requests_ = 0;
+
+    // The neighborhoods and degrees received from the server. The degrees
+    // are kept in a list from the most recently used to the least recently
+    // used, with the position of each vertex in the list.
+    NeighborhoodCache cache_;
+    std::list<std::pair<StagInt, VertexDegrees>> degree_order_;
+    std::unordered_map<StagInt,
+        std::list<std::pair<StagInt, VertexDegrees>>::iterator> degree_cache_;
+  };
+}
+
+#endif //STAG_LIBRARY_GRAPHSERVER_H
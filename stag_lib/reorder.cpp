@@ -0,0 +1,244 @@
+/*
+   This file is provided as part of the STAG library and released under the GPL
+   license.
+*/
+// Standard C++ libraries
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+// STAG modules
+#include "reorder.h"
+
+//------------------------------------------------------------------------------
+// Vertex Orderings
+//------------------------------------------------------------------------------
+/**
+ * Visit the vertices of the graph in breadth-first order, beginning a new
+ * search from the first unvisited vertex in start_order whenever a connected
+ * component has been exhausted.
+ *
+ * If sort_neighbors is true, the unvisited neighbors of each vertex are
+ * visited in increasing order of degree. Otherwise, they are visited in the
+ * order in which they are stored.
+ *
+ * @return the vertices in the order in which they are visited
+ */
+std::vector<StagInt> breadth_first_order(const SprsMat* adj,
+                                         const std::vector<StagInt>& start_order,
+                                         const std::vector<StagInt>& degrees,
+                                         bool sort_neighbors) {
+  const StagInt *colStarts = adj->outerIndexPtr();
+  const StagInt *rowIndices = adj->innerIndexPtr();
+  const StagReal *values = adj->valuePtr();
+  auto n = (StagInt) start_order.size();
+
+  // The order vector is also used as the queue for the search: the vertices
+  // between the head and the end of the vector have been discovered but not
+  // yet processed.
+  std::vector<StagInt> order;
+  order.reserve(n);
+  std::vector<bool> visited(n, false);
+  std::vector<StagInt> new_neighbors;
+  StagInt head = 0;
+
+  for (StagInt start : start_order) {
+    if (visited[start]) continue;
+    visited[start] = true;
+    order.push_back(start);
+
+    while (head < (StagInt) order.size()) {
+      StagInt u = order[head++];
+
+      new_neighbors.clear();
+      for (StagInt k = colStarts[u]; k < colStarts[u + 1]; k++) {
+        // Skip the tombstones of edges removed from a dynamic graph.
+        if (values[k] == 0) continue;
+        StagInt v = rowIndices[k];
+        if (!visited[v]) {
+          visited[v] = true;
+          new_neighbors.push_back(v);
+        }
+      }
+
+      if (sort_neighbors) {
+        std::stable_sort(new_neighbors.begin(), new_neighbors.end(),
+                         [&degrees](StagInt a, StagInt b) {
+                           return degrees[a] < degrees[b];
+                         });
+      }
+      order.insert(order.end(), new_neighbors.begin(), new_neighbors.end());
+    }
+  }
+
+  return order;
+}
+
+std::vector<StagInt> stag::vertex_ordering(stag::Graph* graph,
+                                           stag::VertexOrdering ordering) {
+  const SprsMat* adj = graph->adjacency();
+  const StagInt *colStarts = adj->outerIndexPtr();
+  const StagReal *values = adj->valuePtr();
+  StagInt n = graph->number_of_vertices();
+
+  // The orderings are based on the number of neighbors of each vertex, which
+  // determines the amount of memory used to store its column of the
+  // adjacency matrix. The tombstones of edges removed from a dynamic graph
+  // are not counted.
+  std::vector<StagInt> degrees(n, 0);
+  for (StagInt v = 0; v < n; v++) {
+    for (StagInt k = colStarts[v]; k < colStarts[v + 1]; k++) {
+      if (values[k] != 0) degrees[v]++;
+    }
+  }
+
+  std::vector<StagInt> vertices_by_degree(n);
+  std::iota(vertices_by_degree.begin(), vertices_by_degree.end(), 0);
+  std::stable_sort(vertices_by_degree.begin(), vertices_by_degree.end(),
+                   [&degrees](StagInt a, StagInt b) {
+                     return degrees[a] < degrees[b];
+                   });
+
+  std::vector<StagInt> order;
+  switch (ordering) {
+    case stag::VertexOrdering::ReverseCuthillMcKee:
+      // Begin each search from the vertex of lowest degree, and reverse the
+      // order at the end.
+      order = breadth_first_order(adj, vertices_by_degree, degrees, true);
+      std::reverse(order.begin(), order.end());
+      break;
+    case stag::VertexOrdering::DegreeSort:
+      order.assign(vertices_by_degree.rbegin(), vertices_by_degree.rend());
+      break;
+    case stag::VertexOrdering::BreadthFirst:
+      // Begin each search from the vertex of highest degree.
+      std::reverse(vertices_by_degree.begin(), vertices_by_degree.end());
+      order = breadth_first_order(adj, vertices_by_degree, degrees, false);
+      break;
+    default:
+      throw std::invalid_argument("Unknown vertex ordering.");
+  }
+
+  // The order gives the original vertex at each new position, and so the
+  // permutation is its inverse.
+  std::vector<StagInt> permutation(n);
+  for (StagInt i = 0; i < n; i++) permutation[order[i]] = i;
+  return permutation;
+}
+
+//------------------------------------------------------------------------------
+// Relabelling graphs
+//------------------------------------------------------------------------------
+/**
+ * Invert a permutation of the vertices of a graph.
+ *
+ * @throws std::invalid_argument if the vector is not a permutation of
+ *         0, ..., n - 1
+ */
+std::vector<StagInt> invert_permutation(const std::vector<StagInt>& permutation,
+                                        StagInt n) {
+  if ((StagInt) permutation.size() != n) {
+    throw std::invalid_argument("Permutation size must equal the number of vertices.");
+  }
+
+  std::vector<StagInt> inverse(n, -1);
+  for (StagInt v = 0; v < n; v++) {
+    StagInt i = permutation[v];
+    if (i < 0 || i >= n || inverse[i] != -1) {
+      throw std::invalid_argument("Vertex labels must be a permutation of the vertices.");
+    }
+    inverse[i] = v;
+  }
+  return inverse;
+}
+
+stag::Graph stag::permute_graph(stag::Graph* graph,
+                                const std::vector<StagInt>& permutation) {
+  const SprsMat* adj = graph->adjacency();
+  const StagInt *colStarts = adj->outerIndexPtr();
+  const StagInt *rowIndices = adj->innerIndexPtr();
+  const StagReal *values = adj->valuePtr();
+  StagInt n = graph->number_of_vertices();
+  std::vector<StagInt> inverse = invert_permutation(permutation, n);
+
+  // The column i of the new adjacency matrix is the column inverse[i] of the
+  // original matrix, with the row indices relabelled and sorted. The
+  // tombstones of edges removed from a dynamic graph are dropped.
+  std::vector<StagInt> newStarts(n + 1, 0);
+  std::vector<StagInt> newIndices;
+  std::vector<StagReal> newValues;
+  newIndices.reserve(adj->nonZeros());
+  newValues.reserve(adj->nonZeros());
+  std::vector<std::pair<StagInt, StagReal>> column;
+  for (StagInt i = 0; i < n; i++) {
+    StagInt v = inverse[i];
+    column.clear();
+    for (StagInt k = colStarts[v]; k < colStarts[v + 1]; k++) {
+      if (values[k] == 0) continue;
+      column.emplace_back(permutation[rowIndices[k]], values[k]);
+    }
+    std::sort(column.begin(), column.end());
+
+    for (const auto& entry : column) {
+      newIndices.push_back(entry.first);
+      newValues.push_back(entry.second);
+    }
+    newStarts[i + 1] = (StagInt) newIndices.size();
+  }
+
+  return {newStarts, newIndices, newValues};
+}
+
+stag::GraphReordering stag::reorder_graph(stag::Graph* graph,
+                                          stag::VertexOrdering ordering) {
+  std::vector<StagInt> permutation = stag::vertex_ordering(graph, ordering);
+  std::vector<StagInt> inverse = invert_permutation(
+      permutation, graph->number_of_vertices());
+  return {stag::permute_graph(graph, permutation), permutation, inverse};
+}
+
+//------------------------------------------------------------------------------
+// Restoring the original labels
+//------------------------------------------------------------------------------
+std::vector<StagInt> stag::restore_vertex_labels(const stag::GraphReordering& reordering,
+                                                 const std::vector<StagInt>& labels) {
+  auto n = (StagInt) reordering.permutation.size();
+  if ((StagInt) labels.size() != n) {
+    throw std::invalid_argument("Number of labels must equal the number of vertices.");
+  }
+
+  std::vector<StagInt> original_labels(n);
+  for (StagInt v = 0; v < n; v++) {
+    original_labels[v] = labels[reordering.permutation[v]];
+  }
+  return original_labels;
+}
+
+std::vector<StagInt> stag::restore_vertex_ids(const stag::GraphReordering& reordering,
+                                              const std::vector<StagInt>& vertices) {
+  auto n = (StagInt) reordering.inverse_permutation.size();
+  std::vector<StagInt> original_ids;
+  original_ids.reserve(vertices.size());
+  for (StagInt i : vertices) {
+    if (i < 0 || i >= n) {
+      throw std::invalid_argument("Vertex index out of range.");
+    }
+    original_ids.push_back(reordering.inverse_permutation[i]);
+  }
+  return original_ids;
+}
+
+Eigen::MatrixXd stag::restore_vertex_order(const stag::GraphReordering& reordering,
+                                           const Eigen::MatrixXd& vectors) {
+  auto n = (StagInt) reordering.permutation.size();
+  if (vectors.rows() != n) {
+    throw std::invalid_argument("Number of rows must equal the number of vertices.");
+  }
+
+  Eigen::MatrixXd original_vectors(n, vectors.cols());
+  for (StagInt v = 0; v < n; v++) {
+    original_vectors.row(v) = vectors.row(reordering.permutation[v]);
+  }
+  return original_vectors;
+}
@@ -0,0 +1,172 @@
+/*
+   This file is provided as part of the STAG library and released under the GPL
+   license.
+*/
+
+/**
+ * @file reorder.h
+ * \brief Methods for relabelling the vertices of a graph.
+ *
+ * The order in which the vertices of a graph are labelled determines the
+ * layout of its adjacency matrix in memory. Algorithms which scan the
+ * neighbors of many vertices, such as the matrix-vector products used to
+ * compute eigenvectors and the local clustering algorithms, run faster when
+ * the neighbors of each vertex are stored close together.
+ *
+ * The methods in this module relabel the vertices of a graph according to an
+ * ordering which improves this locality, and map the results of algorithms
+ * on the relabelled graph back to the original vertex labels.
+ *
+ * \code{.cpp}
+ *     #include <stag/graph.h>
+ *     #include <stag/random.h>
+ *     #include <stag/cluster.h>
+ *     #include <stag/reorder.h>
+ *
+ *     int main() {
+ *       stag::Graph myGraph = stag::sbm(1000, 2, 0.1, 0.01);
+ *
+ *       // Relabel the vertices with the reverse Cuthill-McKee ordering.
+ *       stag::GraphReordering reordering = stag::reorder_graph(
+ *           &myGraph, stag::VertexOrdering::ReverseCuthillMcKee);
+ *
+ *       // Cluster the relabelled graph, and return the cluster of each
+ *       // vertex in the original graph.
+ *       std::vector<StagInt> labels = stag::spectral_cluster(&reordering.graph, 2);
+ *       labels = stag::restore_vertex_labels(reordering, labels);
+ *
+ *       return 0;
+ *     }
+ * \endcode
+ */
+
+#ifndef STAG_LIBRARY_REORDER_H
+#define STAG_LIBRARY_REORDER_H
+
+#include <vector>
+
+#include "definitions.h"
+#include "graph.h"
+
+namespace stag {
+
+  /**
+   * The orderings which can be used to relabel the vertices of a graph.
+   *
+   *   - ReverseCuthillMcKee: a breadth-first search from a low-degree
+   *     vertex in each connected component, visiting the neighbors of each
+   *     vertex in increasing order of degree, with the resulting order
+   *     reversed. This reduces the bandwidth of the adjacency matrix.
+   *   - DegreeSort: the vertices are sorted in decreasing order of degree,
+   *     so that the high-degree vertices of a scale-free graph, which are
+   *     neighbors of many other vertices, are stored together.
+   *   - BreadthFirst: a breadth-first search from the highest-degree vertex
+   *     in each connected component, so that vertices in the same densely
+   *     connected cluster receive nearby labels.
+   */
+  enum VertexOrdering {ReverseCuthillMcKee, DegreeSort, BreadthFirst};
+
+  /**
+   * \brief A graph with relabelled vertices, together with the mapping between
+   * the original and new vertex labels.
+   */
+  struct GraphReordering {
+    /**
+     * The relabelled graph.
+     */
+    stag::Graph graph;
+
+    /**
+     * The new label of each vertex. That is, the vertex \f$v\f$ in the
+     * original graph is the vertex permutation[v] in the relabelled graph.
+     */
+    std::vector<StagInt> permutation;
+
+    /**
+     * The original label of each vertex. That is, the vertex \f$i\f$ in the
+     * relabelled graph is the vertex inverse_permutation[i] in the original
+     * graph.
+     */
+    std::vector<StagInt> inverse_permutation;
+  };
+
+  /**
+   * Compute an ordering of the vertices of a graph.
+   *
+   * See stag::VertexOrdering for a description of the available orderings.
+   *
+   * @param graph the graph whose vertices to order
+   * @param ordering which ordering to compute
+   * @return the new label of each vertex, in the format of
+   *         stag::GraphReordering::permutation
+   */
+  std::vector<StagInt> vertex_ordering(stag::Graph* graph,
+                                       stag::VertexOrdering ordering);
+
+  /**
+   * Construct a copy of a graph with relabelled vertices.
+   *
+   * @param graph the graph to relabel
+   * @param permutation the new label of each vertex in the graph
+   * @return the relabelled graph
+   * @throws std::invalid_argument if the permutation is not a permutation of
+   *         the vertices of the graph
+   */
+  stag::Graph permute_graph(stag::Graph* graph,
+                            const std::vector<StagInt>& permutation);
+
+  /**
+   * Relabel the vertices of a graph according to the given ordering.
+   *
+   * @param graph the graph to relabel
+   * @param ordering which ordering to use
+   * @return a stag::GraphReordering object containing the relabelled graph
+   *         and the permutation of its vertices
+   */
+  stag::GraphReordering reorder_graph(stag::Graph* graph,
+                                      stag::VertexOrdering ordering);
+
+  /**
+   * Given a label for every vertex of a relabelled graph, such as the cluster
+   * memberships returned by stag::spectral_cluster, return the labels in the
+   * order of the vertices of the original graph.
+   *
+   * @param reordering the reordering used to relabel the graph
+   * @param labels a label for each vertex of the relabelled graph
+   * @return the label of each vertex of the original graph
+   * @throws std::invalid_argument if the number of labels is not equal to the
+   *         number of vertices in the graph
+   */
+  std::vector<StagInt> restore_vertex_labels(const stag::GraphReordering& reordering,
+                                             const std::vector<StagInt>& labels);
+
+  /**
+   * Given a set of vertices of a relabelled graph, such as the cluster
+   * returned by stag::local_cluster, return the labels of the same vertices
+   * in the original graph.
+   *
+   * @param reordering the reordering used to relabel the graph
+   * @param vertices vertex ids in the relabelled graph
+   * @return the corresponding vertex ids in the original graph
+   * @throws std::invalid_argument if any vertex id is not in the graph
+   */
+  std::vector<StagInt> restore_vertex_ids(const stag::GraphReordering& reordering,
+                                          const std::vector<StagInt>& vertices);
+
+  /**
+   * Given a matrix with one row for every vertex of a relabelled graph, such
+   * as the eigenvectors returned by stag::compute_eigenvectors, return the
+   * matrix with the rows in the order of the vertices of the original graph.
+   *
+   * @param reordering the reordering used to relabel the graph
+   * @param vectors a matrix with one row for each vertex of the relabelled
+   *                graph
+   * @return the matrix with rows in the original vertex order
+   * @throws std::invalid_argument if the number of rows is not equal to the
+   *         number of vertices in the graph
+   */
+  Eigen::MatrixXd restore_vertex_order(const stag::GraphReordering& reordering,
+                                       const Eigen::MatrixXd& vectors);
+}
+
+#endif //STAG_LIBRARY_REORDER_H
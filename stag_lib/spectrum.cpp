@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <random>
 #include <utility>
+#include <cmath>
 
 // Other libraries
 #include <Spectra/SymEigsSolver.h>
@@ -14,23 +15,167 @@
 // STAG modules
 #include "spectrum.h"
 
+/*
+ * Used to disable compiler warning for unused variable.
+ */
+template<class T> void ignore_warning(const T&){}
+
+//------------------------------------------------------------------------------
+// Matrix-free graph matrix operator
+//------------------------------------------------------------------------------
+stag::GraphMatrixOp::GraphMatrixOp(const stag::Graph* g, stag::GraphMatrix mat,
+                                   StagReal scale, StagReal shift)
+  : n_(g->number_of_vertices()),
+    col_starts_(g->adjacency()->outerIndexPtr()),
+    row_indices_(g->adjacency()->innerIndexPtr()),
+    weights_(g->adjacency()->valuePtr()), weighted_(true),
+    graph_degrees_(g->degree_vector()), mat_(mat), scale_(scale), shift_(shift) {
+  initialise_inv_sqrt_degrees_();
+}
+
+stag::GraphMatrixOp::GraphMatrixOp(const stag::Graph* g, stag::GraphMatrix mat)
+  : GraphMatrixOp(g, mat, 1, 0) {}
+
+stag::GraphMatrixOp::GraphMatrixOp(const stag::UnweightedGraph* g,
+                                   stag::GraphMatrix mat,
+                                   StagReal scale, StagReal shift)
+  : n_(g->number_of_vertices()),
+    col_starts_(g->outer_starts()->data()),
+    row_indices_(g->inner_indices()->data()),
+    weights_(nullptr), weighted_(false), graph_degrees_(nullptr),
+    mat_(mat), scale_(scale), shift_(shift) {
+  // The degree of each vertex is the number of its neighbors, with
+  // self-loops counted twice.
+  unweighted_degrees_.resize(n_);
+  for (StagInt v = 0; v < n_; v++) {
+    StagReal deg = (StagReal) (col_starts_[v + 1] - col_starts_[v]);
+    if (std::binary_search(row_indices_ + col_starts_[v],
+                           row_indices_ + col_starts_[v + 1], v)) {
+      deg += 1;
+    }
+    unweighted_degrees_[v] = deg;
+  }
+  initialise_inv_sqrt_degrees_();
+}
+
+stag::GraphMatrixOp::GraphMatrixOp(const stag::UnweightedGraph* g,
+                                   stag::GraphMatrix mat)
+  : GraphMatrixOp(g, mat, 1, 0) {}
+
+void stag::GraphMatrixOp::initialise_inv_sqrt_degrees_() {
+  // The normalised matrices need the inverse square root of the degrees.
+  if (mat_ == stag::GraphMatrix::NormalisedLaplacian ||
+      mat_ == stag::GraphMatrix::NormalisedSignlessLaplacian) {
+    const std::vector<StagReal>& degrees =
+        weighted_ ? *graph_degrees_ : unweighted_degrees_;
+    inv_sqrt_degrees_.reserve(degrees.size());
+    for (StagReal deg : degrees) {
+      inv_sqrt_degrees_.push_back(deg > 0 ? 1 / std::sqrt(deg) : 0);
+    }
+  }
+}
+
+StagInt stag::GraphMatrixOp::rows() const {
+  return n_;
+}
+
+StagInt stag::GraphMatrixOp::cols() const {
+  return n_;
+}
 
+void stag::GraphMatrixOp::perform_op(const StagReal* x_in, StagReal* y_out) const {
+  if (weighted_) {
+    multiply_<true>(x_in, y_out);
+  } else {
+    multiply_<false>(x_in, y_out);
+  }
+}
+
+template <bool weighted>
+void stag::GraphMatrixOp::multiply_(const StagReal* x_in, StagReal* y_out) const {
+  const std::vector<StagReal>& degrees =
+      weighted ? *graph_degrees_ : unweighted_degrees_;
+
+  // The weight of the k-th non-zero entry of the adjacency matrix. For an
+  // unweighted graph, the weight array is never read.
+  auto weight = [this](StagInt k) -> StagReal {
+    if constexpr (weighted) {
+      return weights_[k];
+    } else {
+      ignore_warning(k);
+      return 1;
+    }
+  };
+
+  // Since the adjacency matrix is symmetric, the v-th entry of Ax is the dot
+  // product of x with the v-th column of A.
+  for (StagInt v = 0; v < n_; v++) {
+    StagReal y = 0;
+    switch (mat_) {
+      case stag::GraphMatrix::Adjacency:
+        for (StagInt k = col_starts_[v]; k < col_starts_[v + 1]; k++) {
+          y += weight(k) * x_in[row_indices_[k]];
+        }
+        break;
+      case stag::GraphMatrix::Laplacian:
+        // L = D - A
+        for (StagInt k = col_starts_[v]; k < col_starts_[v + 1]; k++) {
+          y -= weight(k) * x_in[row_indices_[k]];
+        }
+        y += degrees[v] * x_in[v];
+        break;
+      case stag::GraphMatrix::SignlessLaplacian:
+        // J = D + A
+        for (StagInt k = col_starts_[v]; k < col_starts_[v + 1]; k++) {
+          y += weight(k) * x_in[row_indices_[k]];
+        }
+        y += degrees[v] * x_in[v];
+        break;
+      case stag::GraphMatrix::NormalisedLaplacian:
+        // I - D^{-1/2} A D^{-1/2}
+        for (StagInt k = col_starts_[v]; k < col_starts_[v + 1]; k++) {
+          y -= weight(k) * inv_sqrt_degrees_[row_indices_[k]] * x_in[row_indices_[k]];
+        }
+        y = x_in[v] + inv_sqrt_degrees_[v] * y;
+        break;
+      case stag::GraphMatrix::NormalisedSignlessLaplacian:
+        // I + D^{-1/2} A D^{-1/2}
+        for (StagInt k = col_starts_[v]; k < col_starts_[v + 1]; k++) {
+          y += weight(k) * inv_sqrt_degrees_[row_indices_[k]] * x_in[row_indices_[k]];
+        }
+        y = x_in[v] + inv_sqrt_degrees_[v] * y;
+        break;
+    }
+    y_out[v] = scale_ * y + shift_ * x_in[v];
+  }
+}
+
+Eigen::VectorXd stag::GraphMatrixOp::operator*(const Eigen::VectorXd& x) const {
+  if (x.size() != cols()) throw std::invalid_argument("Vector and matrix must have the same dimension");
+  Eigen::VectorXd y(rows());
+  perform_op(x.data(), y.data());
+  return y;
+}
+
+//------------------------------------------------------------------------------
+// Computing eigenvalues and eigenvectors
+//------------------------------------------------------------------------------
 /**
- * Compute the eigensystem of a matrix, beginning with the largest eigenvalues.
+ * Compute the eigensystem of a matrix operator, beginning with the largest
+ * eigenvalues.
  *
  * Add offset to the eigenvalues before returning them.
  */
+template <typename OpType>
 stag::EigenSystem compute_eigensystem_largestmag(
-    const SprsMat* mat, StagInt num, StagReal offset, bool invert) {
-  if (num < 1 || num >= mat->rows()) {
+    OpType& op, StagInt num, StagReal offset, bool invert) {
+  if (num < 1 || num >= op.rows()) {
     throw std::invalid_argument("Number of computed eigenvectors must be between 1 and n - 1.");
   }
 
-  stag::SprsMatProdOp op(*mat);
-
   // Construct eigen solver object, requesting the smallest k eigenvalues
-  long ncv = std::min<StagInt>(10 * num, mat->rows());
-  Spectra::SymEigsSolver<stag::SprsMatProdOp> eigs(op, num, ncv);
+  long ncv = std::min<StagInt>(10 * num, op.rows());
+  Spectra::SymEigsSolver<OpType> eigs(op, num, ncv);
 
   // Initialize and compute
   eigs.init();
@@ -59,65 +204,57 @@ stag::EigenSystem compute_eigensystem_largestmag(
   return {eigenvalues, eigenvectors};
 }
 
-stag::EigenSystem stag::compute_eigensystem(
-    stag::Graph* g, stag::GraphMatrix mat, StagInt num, stag::EigenSortRule which) {
+/**
+ * Compute the eigensystem of one of the matrices of a graph, given the
+ * maximum degree of the graph.
+ *
+ * The GraphType may be any graph from which a stag::GraphMatrixOp can be
+ * constructed.
+ */
+template <typename GraphType>
+stag::EigenSystem compute_graph_eigensystem(
+    GraphType* g, stag::GraphMatrix mat, StagInt num, stag::EigenSortRule which,
+    StagReal max_degree) {
   if (num < 1 || num >= g->number_of_vertices()) {
     throw std::invalid_argument("Number of computed eigenvectors must be between 1 and n - 1.");
   }
 
-  // Get the maximum degree of the graph
-  StagReal max_degree = 0;
-  for (auto i = 0; i < g->number_of_vertices(); i++) {
-    max_degree = MAX(g->degree(i), max_degree);
-  }
-
+  // Each graph matrix is applied to vectors by a matrix-free operator, which
+  // avoids constructing a shifted copy of the matrix for the eigen solver.
   switch (mat) {
     case stag::GraphMatrix::Adjacency:
       if (which == stag::EigenSortRule::Largest) {
         // We will find the maximum eigenvalues of A + d_max I.
-        SprsMat adjusted_adjacency = *g->adjacency();
-        for (auto i = 0; i < g->number_of_vertices(); i++) {
-          adjusted_adjacency.coeffRef(i, i) += max_degree;
-        }
-        return compute_eigensystem_largestmag(
-            &adjusted_adjacency, num, -max_degree, false);
+        stag::GraphMatrixOp op(g, mat, 1, max_degree);
+        return compute_eigensystem_largestmag(op, num, -max_degree, false);
       } else {
         // We will find the maximum eigenvalues of -A + d_max I.
-        SprsMat adjusted_adjacency = - (*g->adjacency());
-        for (auto i = 0; i < g->number_of_vertices(); i++) {
-          adjusted_adjacency.coeffRef(i, i) += max_degree;
-        }
-        return compute_eigensystem_largestmag(
-            &adjusted_adjacency, num, -max_degree, true);
+        stag::GraphMatrixOp op(g, mat, -1, max_degree);
+        return compute_eigensystem_largestmag(op, num, -max_degree, true);
       }
       break;
     case stag::GraphMatrix::Laplacian:
+    case stag::GraphMatrix::SignlessLaplacian:
       if (which == stag::EigenSortRule::Largest) {
         // We can just compute the largest eigenvalues directly.
-        return compute_eigensystem_largestmag(g->laplacian(), num, 0, false);
+        stag::GraphMatrixOp op(g, mat);
+        return compute_eigensystem_largestmag(op, num, 0, false);
       } else {
         // We will find the maximum eigenvalues of (2 d_max I - L).
-        SprsMat adjusted_laplacian = - (*g->laplacian());
-        for (auto i = 0; i < g->number_of_vertices(); i++) {
-          adjusted_laplacian.coeffRef(i, i) += 2 * max_degree;
-        }
-        return compute_eigensystem_largestmag(
-            &adjusted_laplacian, num, -(2 * max_degree), true);
+        stag::GraphMatrixOp op(g, mat, -1, 2 * max_degree);
+        return compute_eigensystem_largestmag(op, num, -(2 * max_degree), true);
       }
       break;
     case stag::GraphMatrix::NormalisedLaplacian:
+    case stag::GraphMatrix::NormalisedSignlessLaplacian:
       if (which == stag::EigenSortRule::Largest) {
         // We can just compute the largest eigenvalues directly.
-        return compute_eigensystem_largestmag(
-            g->normalised_laplacian(), num, 0, false);
+        stag::GraphMatrixOp op(g, mat);
+        return compute_eigensystem_largestmag(op, num, 0, false);
       } else {
         // We will find the maximum eigenvalues of (2 I - L).
-        SprsMat adjusted_laplacian = - (*g->normalised_laplacian());
-        for (auto i = 0; i < g->number_of_vertices(); i++) {
-          adjusted_laplacian.coeffRef(i, i) += 2;
-        }
-        return compute_eigensystem_largestmag(
-            &adjusted_laplacian, num, -2, true);
+        stag::GraphMatrixOp op(g, mat, -1, 2);
+        return compute_eigensystem_largestmag(op, num, -2, true);
       }
       break;
     default:
@@ -129,6 +266,30 @@ stag::EigenSystem stag::compute_eigensystem(
   throw std::runtime_error("Failed to compute eigenvectors.");
 }
 
+stag::EigenSystem stag::compute_eigensystem(
+    stag::Graph* g, stag::GraphMatrix mat, StagInt num, stag::EigenSortRule which) {
+  // Get the maximum degree of the graph
+  const std::vector<StagReal>* degrees = g->degree_vector();
+  StagReal max_degree = 0;
+  if (!degrees->empty()) {
+    max_degree = *std::max_element(degrees->begin(), degrees->end());
+  }
+
+  return compute_graph_eigensystem(g, mat, num, which, max_degree);
+}
+
+stag::EigenSystem stag::compute_eigensystem(
+    stag::UnweightedGraph* g, stag::GraphMatrix mat, StagInt num,
+    stag::EigenSortRule which) {
+  // Get the maximum degree of the graph
+  StagReal max_degree = 0;
+  for (StagInt v = 0; v < g->number_of_vertices(); v++) {
+    max_degree = MAX(max_degree, g->degree(v));
+  }
+
+  return compute_graph_eigensystem(g, mat, num, which, max_degree);
+}
+
 Eigen::MatrixXd stag::compute_eigenvectors(
     stag::Graph* g, stag::GraphMatrix mat, StagInt num, stag::EigenSortRule which) {
   return get<1>(stag::compute_eigensystem(g, mat, num, which));
@@ -139,6 +300,18 @@ Eigen::VectorXd stag::compute_eigenvalues(
   return get<0>(stag::compute_eigensystem(g, mat, num, which));
 }
 
+Eigen::MatrixXd stag::compute_eigenvectors(
+    stag::UnweightedGraph* g, stag::GraphMatrix mat, StagInt num,
+    stag::EigenSortRule which) {
+  return get<1>(stag::compute_eigensystem(g, mat, num, which));
+}
+
+Eigen::VectorXd stag::compute_eigenvalues(
+    stag::UnweightedGraph* g, stag::GraphMatrix mat, StagInt num,
+    stag::EigenSortRule which) {
+  return get<0>(stag::compute_eigensystem(g, mat, num, which));
+}
+
 /**
  * Generate a random unit vector with the given dimension.
  *
@@ -70,7 +70,156 @@ namespace stag {
    * When computing eigenvectors and eigenvalues, these values are used to
    * specify which Graph matrix we are using to compute the spectrum.
    */
-  enum GraphMatrix {Adjacency, Laplacian, NormalisedLaplacian};
+  enum GraphMatrix {Adjacency, Laplacian, NormalisedLaplacian,
+                    SignlessLaplacian, NormalisedSignlessLaplacian};
+
+  /**
+   * \brief A matrix-free operator for multiplying vectors by a graph matrix.
+   *
+   * Given a graph \f$G\f$ and one of its matrices \f$M\f$, this operator
+   * computes
+   *
+   * \f[
+   *    y = \alpha M x + \beta x
+   * \f]
+   *
+   * directly from the adjacency matrix and vertex degrees of the graph,
+   * without constructing \f$M\f$. For example, with \f$\alpha = -1\f$ and
+   * \f$\beta = 2\f$, the operator multiplies vectors by
+   * \f$2 I - \mathcal{L}\f$ where \f$\mathcal{L}\f$ is the normalised
+   * Laplacian matrix.
+   *
+   * The operator satisfies the requirements of the `OpType` template argument
+   * of the Spectra eigen solvers, and is used by stag::compute_eigensystem.
+   *
+   * \code{.cpp}
+   *     #include <Spectra/SymEigsSolver.h>
+   *     #include <stag/graph.h>
+   *     #include <stag/spectrum.h>
+   *
+   *     int main() {
+   *       stag::Graph myGraph = stag::cycle_graph(10);
+   *
+   *       // Find the largest eigenvalues of the Laplacian matrix
+   *       stag::GraphMatrixOp op(&myGraph, stag::GraphMatrix::Laplacian);
+   *       Spectra::SymEigsSolver<stag::GraphMatrixOp> eigs(op, 3, 6);
+   *       eigs.init();
+   *       eigs.compute(Spectra::SortRule::LargestAlge);
+   *
+   *       return 0;
+   *     }
+   * \endcode
+   *
+   * The operator can also be constructed for a stag::UnweightedGraph, in
+   * which case every edge weight is taken to be 1 without being read from
+   * memory.
+   *
+   * The operator refers to the adjacency matrix of the graph, and so it must
+   * not be used after the graph is modified or destroyed.
+   */
+  class GraphMatrixOp {
+    public:
+      /**
+       * \cond
+       */
+      using Scalar = StagReal;
+      /**
+       * \endcond
+       */
+
+      /**
+       * Construct an operator for multiplying by \f$\alpha M + \beta I\f$.
+       *
+       * @param g the graph on which to operate
+       * @param mat which graph matrix \f$M\f$ to multiply by
+       * @param scale (optional) the scalar \f$\alpha\f$. Default \f$1\f$.
+       * @param shift (optional) the scalar \f$\beta\f$. Default \f$0\f$.
+       */
+      GraphMatrixOp(const stag::Graph* g, stag::GraphMatrix mat,
+                    StagReal scale, StagReal shift);
+
+      /**
+       * \overload
+       */
+      GraphMatrixOp(const stag::Graph* g, stag::GraphMatrix mat);
+
+      /**
+       * Construct an operator for multiplying by \f$\alpha M + \beta I\f$,
+       * where \f$M\f$ is a matrix of an unweighted graph.
+       *
+       * @param g the unweighted graph on which to operate
+       * @param mat which graph matrix \f$M\f$ to multiply by
+       * @param scale (optional) the scalar \f$\alpha\f$. Default \f$1\f$.
+       * @param shift (optional) the scalar \f$\beta\f$. Default \f$0\f$.
+       */
+      GraphMatrixOp(const stag::UnweightedGraph* g, stag::GraphMatrix mat,
+                    StagReal scale, StagReal shift);
+
+      /**
+       * \overload
+       */
+      GraphMatrixOp(const stag::UnweightedGraph* g, stag::GraphMatrix mat);
+
+      /**
+       * The number of rows of the operator.
+       */
+      StagInt rows() const;
+
+      /**
+       * The number of columns of the operator.
+       */
+      StagInt cols() const;
+
+      /**
+       * Compute \f$y = \alpha M x + \beta x\f$.
+       *
+       * @param x_in pointer to the input vector \f$x\f$
+       * @param y_out pointer to the output vector \f$y\f$
+       */
+      void perform_op(const StagReal* x_in, StagReal* y_out) const;
+
+      /**
+       * \overload
+       */
+      Eigen::VectorXd operator*(const Eigen::VectorXd& x) const;
+
+    private:
+      /**
+       * Compute \f$y = \alpha M x + \beta x\f$, reading the edge weights
+       * from memory only if the graph is weighted.
+       */
+      template <bool weighted>
+      void multiply_(const StagReal* x_in, StagReal* y_out) const;
+
+      /**
+       * Compute the inverse square root of the degrees if they are needed
+       * by the graph matrix.
+       */
+      void initialise_inv_sqrt_degrees_();
+
+      // The compressed sparse adjacency matrix of the graph on which to
+      // operate. For an unweighted graph, the weights_ pointer is null. The
+      // pointer is also null for a weighted graph with no edges, and so
+      // weighted_ records which kind of graph was given.
+      StagInt n_;
+      const StagInt* col_starts_;
+      const StagInt* row_indices_;
+      const StagReal* weights_;
+      bool weighted_;
+
+      // The degrees of the graph. A weighted graph stores its own degrees,
+      // and the degrees of an unweighted graph are computed by the operator.
+      const std::vector<StagReal>* graph_degrees_;
+      std::vector<StagReal> unweighted_degrees_;
+
+      // For the normalised matrices, the inverse square root of each vertex
+      // degree, or 0 for vertices with degree 0.
+      std::vector<StagReal> inv_sqrt_degrees_;
+
+      stag::GraphMatrix mat_;
+      StagReal scale_;
+      StagReal shift_;
+  };
 
   /**
    * Compute the eigenvalues and eigenvectors of a graph matrix.
@@ -115,6 +264,14 @@ namespace stag {
                                         StagInt num_eigs,
                                         stag::EigenSortRule which);
 
+  /**
+   * \overload
+   */
+  stag::EigenSystem compute_eigensystem(stag::UnweightedGraph* g,
+                                        stag::GraphMatrix mat,
+                                        StagInt num_eigs,
+                                        stag::EigenSortRule which);
+
   /**
    * Compute the eigenvectors of a graph matrix.
    *
@@ -133,6 +290,14 @@ namespace stag {
                                        StagInt num_eigs,
                                        stag::EigenSortRule which);
 
+  /**
+   * \overload
+   */
+  Eigen::MatrixXd compute_eigenvectors(stag::UnweightedGraph* g,
+                                       stag::GraphMatrix mat,
+                                       StagInt num_eigs,
+                                       stag::EigenSortRule which);
+
   /**
    * Compute the eigenvalues of a graph matrix.
    *
@@ -154,6 +319,14 @@ namespace stag {
                                       StagInt num_eigs,
                                       stag::EigenSortRule which);
 
+  /**
+   * \overload
+   */
+  Eigen::VectorXd compute_eigenvalues(stag::UnweightedGraph* g,
+                                      stag::GraphMatrix mat,
+                                      StagInt num_eigs,
+                                      stag::EigenSortRule which);
+
   /**
    * Apply the power method to compute the dominant eigenvector of a matrix.
    *
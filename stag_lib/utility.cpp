@@ -4,8 +4,29 @@
 */
 #include <iterator>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <future>
+#include "multithreading/ctpl_stl.h"
 #include "utility.h"
 
+/*
+ * Matrices with fewer non-zero entries than this are constructed on a single
+ * thread, since starting the threads would take longer than the construction.
+ */
+#define SPRSMAT_PARALLEL_CUTOFF 100000
+
+/*
+ * Columns with at most this many entries are sorted with insertion sort.
+ */
+#define SPRSMAT_INSERTION_SORT_CUTOFF 32
+
+/*
+ * Used to disable compiler warning for unused variable.
+ */
+template<class T> void ignore_warning(const T&){}
+
 std::vector<StagInt> stag::sprsMatInnerIndices(const SprsMat *matrix) {
   // Make sure that the given matrix is compressed
   assert(matrix->isCompressed());
@@ -84,6 +105,241 @@ SprsMat stag::sprsMatFromVectors(std::vector<StagInt>& column_starts,
   return constructed_mat;
 }
 
+/**
+ * Call f(chunk_id) for every chunk_id between 0 and num_chunks - 1, running
+ * each call in the given thread pool. A single chunk is run on the calling
+ * thread.
+ */
+template <typename Func>
+void run_chunks(ctpl::thread_pool& pool, StagInt num_chunks, Func f) {
+  if (num_chunks == 1) {
+    f(0);
+    return;
+  }
+
+  std::vector<std::future<void>> futures;
+  for (StagInt chunk_id = 0; chunk_id < num_chunks; chunk_id++) {
+    futures.push_back(
+        pool.push(
+            [&f, chunk_id] (int id) {
+              ignore_warning(id);
+              f(chunk_id);
+            }
+        )
+    );
+  }
+  for (auto& future : futures) future.get();
+}
+
+/**
+ * The triplets of a sparse matrix, stored in one or more vectors. The
+ * triplets are numbered as if the vectors were concatenated in order.
+ */
+class TripletBlocks {
+  public:
+    explicit TripletBlocks(std::vector<const std::vector<EdgeTriplet>*> blocks)
+        : blocks_(std::move(blocks)) {
+      offsets_.push_back(0);
+      for (auto block : blocks_) {
+        offsets_.push_back(offsets_.back() + (StagInt) block->size());
+      }
+    }
+
+    /**
+     * The total number of triplets.
+     */
+    StagInt size() const {
+      return offsets_.back();
+    }
+
+    /**
+     * Call f(t) for every triplet t with number between start and end - 1,
+     * in order.
+     */
+    template <typename Func>
+    void for_each(StagInt start, StagInt end, Func f) const {
+      // Find the block containing the first triplet.
+      StagInt b = std::upper_bound(offsets_.begin(), offsets_.end(), start)
+          - offsets_.begin() - 1;
+      while (start < end) {
+        const std::vector<EdgeTriplet>& block = *blocks_[b];
+        StagInt block_end = MIN(end, offsets_[b + 1]);
+        for (StagInt i = start; i < block_end; i++) f(block[i - offsets_[b]]);
+        start = block_end;
+        b++;
+      }
+    }
+
+  private:
+    std::vector<const std::vector<EdgeTriplet>*> blocks_;
+    std::vector<StagInt> offsets_;
+};
+
+/**
+ * Construct a compressed sparse matrix from triplets which may be split across
+ * several vectors. See stag::sprsMatFromTriplets.
+ */
+SprsMat sprs_mat_from_triplet_blocks(const TripletBlocks& triplets,
+                                     StagInt rows, StagInt cols) {
+  if (rows < 0 || cols < 0) {
+    throw std::invalid_argument("Matrix dimensions cannot be negative.");
+  }
+
+  // Each thread keeps a histogram of the number of entries in each column,
+  // and so the number of threads is limited to keep the memory used by the
+  // histograms below the memory used by the row indices of the matrix.
+  StagInt nnz = triplets.size();
+  StagInt num_threads = 1;
+  if (nnz >= SPRSMAT_PARALLEL_CUTOFF) {
+    num_threads = MAX((StagInt) std::thread::hardware_concurrency(), 1);
+    if (cols > 0) num_threads = MAX(MIN(num_threads, nnz / cols), 1);
+  }
+  ctpl::thread_pool pool(num_threads > 1 ? (int) num_threads : 0);
+
+  // Count the entries in each column, with every thread counting a
+  // contiguous chunk of the triplets.
+  std::vector<StagInt> column_counts(num_threads * cols, 0);
+  std::atomic<bool> out_of_range = false;
+  run_chunks(pool, num_threads, [&](StagInt chunk_id) {
+    StagInt start = chunk_id * nnz / num_threads;
+    StagInt end = (chunk_id + 1) * nnz / num_threads;
+    StagInt* counts = column_counts.data() + chunk_id * cols;
+    triplets.for_each(start, end, [&](const EdgeTriplet& t) {
+      if (t.row() < 0 || t.row() >= rows || t.col() < 0 || t.col() >= cols) {
+        out_of_range = true;
+        return;
+      }
+      counts[t.col()]++;
+    });
+  });
+  if (out_of_range) {
+    throw std::invalid_argument("Triplet indices must lie inside the matrix.");
+  }
+
+  // The prefix sums of the counts give the start of each column, and the
+  // position in each column at which every thread begins writing. The counts
+  // are replaced by these positions. Within each column, the entries from
+  // earlier chunks come first, so that the triplets keep their order.
+  SprsMat matrix(rows, cols);
+  matrix.resizeNonZeros(nnz);
+  StagInt* column_starts = matrix.outerIndexPtr();
+  StagInt* row_indices = matrix.innerIndexPtr();
+  StagReal* values = matrix.valuePtr();
+  StagInt position = 0;
+  for (StagInt c = 0; c < cols; c++) {
+    column_starts[c] = position;
+    for (StagInt chunk_id = 0; chunk_id < num_threads; chunk_id++) {
+      StagInt count = column_counts[chunk_id * cols + c];
+      column_counts[chunk_id * cols + c] = position;
+      position += count;
+    }
+  }
+  column_starts[cols] = position;
+
+  // Scatter the triplets into their columns.
+  run_chunks(pool, num_threads, [&](StagInt chunk_id) {
+    StagInt start = chunk_id * nnz / num_threads;
+    StagInt end = (chunk_id + 1) * nnz / num_threads;
+    StagInt* positions = column_counts.data() + chunk_id * cols;
+    triplets.for_each(start, end, [&](const EdgeTriplet& t) {
+      StagInt pos = positions[t.col()]++;
+      row_indices[pos] = t.row();
+      values[pos] = t.value();
+    });
+  });
+  column_counts.clear();
+  column_counts.shrink_to_fit();
+
+  // Sort each column and sum duplicate entries in place. The columns are
+  // divided between the threads so that each has roughly the same number
+  // of entries. The sort is stable, so that duplicates are summed in the
+  // order of the triplets, as they are by Eigen.
+  std::vector<StagInt> merged_counts(cols);
+  run_chunks(pool, num_threads, [&](StagInt chunk_id) {
+    StagInt first_col = std::lower_bound(column_starts, column_starts + cols,
+                                         chunk_id * nnz / num_threads) - column_starts;
+    StagInt end_col = std::lower_bound(column_starts, column_starts + cols,
+                                       (chunk_id + 1) * nnz / num_threads) - column_starts;
+    if (chunk_id == num_threads - 1) end_col = cols;
+
+    std::vector<std::pair<StagInt, StagReal>> column;
+    auto by_row = [](const std::pair<StagInt, StagReal>& a,
+                     const std::pair<StagInt, StagReal>& b) {
+      return a.first < b.first;
+    };
+    for (StagInt c = first_col; c < end_col; c++) {
+      StagInt start = column_starts[c];
+      StagInt end = column_starts[c + 1];
+      if (end - start <= SPRSMAT_INSERTION_SORT_CUTOFF) {
+        // Most columns are short, and are sorted in place by insertion sort.
+        for (StagInt k = start + 1; k < end; k++) {
+          StagInt row = row_indices[k];
+          StagReal value = values[k];
+          StagInt j = k;
+          while (j > start && row_indices[j - 1] > row) {
+            row_indices[j] = row_indices[j - 1];
+            values[j] = values[j - 1];
+            j--;
+          }
+          row_indices[j] = row;
+          values[j] = value;
+        }
+      } else {
+        column.clear();
+        for (StagInt k = start; k < end; k++) column.emplace_back(row_indices[k], values[k]);
+        std::stable_sort(column.begin(), column.end(), by_row);
+        for (StagInt k = start; k < end; k++) {
+          row_indices[k] = column[k - start].first;
+          values[k] = column[k - start].second;
+        }
+      }
+
+      StagInt write = start;
+      for (StagInt k = start; k < end; k++) {
+        if (write > start && row_indices[write - 1] == row_indices[k]) {
+          values[write - 1] += values[k];
+        } else {
+          row_indices[write] = row_indices[k];
+          values[write] = values[k];
+          write++;
+        }
+      }
+      merged_counts[c] = write - start;
+    }
+  });
+
+  // If there were any duplicates, move the merged columns next to each other.
+  StagInt write = 0;
+  for (StagInt c = 0; c < cols; c++) {
+    StagInt start = column_starts[c];
+    if (write != start) {
+      std::copy(row_indices + start, row_indices + start + merged_counts[c],
+                row_indices + write);
+      std::copy(values + start, values + start + merged_counts[c],
+                values + write);
+    }
+    column_starts[c] = write;
+    write += merged_counts[c];
+  }
+  column_starts[cols] = write;
+  matrix.resizeNonZeros(write);
+
+  return matrix;
+}
+
+SprsMat stag::sprsMatFromTriplets(const std::vector<EdgeTriplet>& triplets,
+                                  StagInt rows, StagInt cols) {
+  return sprs_mat_from_triplet_blocks(TripletBlocks({&triplets}), rows, cols);
+}
+
+SprsMat stag::sprsMatFromTriplets(
+    const std::vector<std::vector<EdgeTriplet>>& triplets,
+    StagInt rows, StagInt cols) {
+  std::vector<const std::vector<EdgeTriplet>*> blocks;
+  for (const auto& block : triplets) blocks.push_back(&block);
+  return sprs_mat_from_triplet_blocks(TripletBlocks(blocks), rows, cols);
+}
+
 bool stag::isSymmetric(const SprsMat *matrix) {
   // Iterate through the non-zero elements in the matrix
   for (int k = 0; k < matrix->outerSize(); ++k) {
@@ -151,8 +407,14 @@ std::string random_string( size_t length )
 }
 
 std::string stag::getTempFilename() {
-  // Get the name of the temporary directory on this filesystem
-  std::filesystem::path temp_dir = std::filesystem::temp_directory_path();
+  return stag::getTempFilename("");
+}
+
+std::string stag::getTempFilename(const std::string& directory) {
+  // Get the name of the temporary directory on this filesystem, unless a
+  // directory is given
+  std::filesystem::path temp_dir = directory.empty() ?
+      std::filesystem::temp_directory_path() : std::filesystem::path(directory);
 
   // Create the random filename
   std::filesystem::path fname("stag_temp_file." + random_string(20));
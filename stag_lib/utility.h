@@ -75,6 +75,42 @@ namespace stag {
                               std::vector<StagInt>& row_indices,
                               std::vector<StagReal>& values);
 
+   /**
+    * Construct a compressed sparse matrix from a vector of triplets.
+    *
+    * This gives the same matrix as Eigen's setFromTriplets method: duplicate
+    * entries are summed, and the row indices within each column are sorted.
+    * The matrix is built in parallel with a counting sort over the columns,
+    * writing directly into the compressed arrays of the returned matrix,
+    * which avoids the intermediate copy of the matrix made by Eigen.
+    *
+    * @param triplets the non-zero entries of the matrix
+    * @param rows the number of rows of the matrix
+    * @param cols the number of columns of the matrix
+    * @return the constructed sparse matrix
+    * @throws std::invalid_argument if any triplet lies outside of the matrix
+    */
+   SprsMat sprsMatFromTriplets(const std::vector<EdgeTriplet>& triplets,
+                               StagInt rows, StagInt cols);
+
+   /**
+    * Construct a compressed sparse matrix from triplets split across several
+    * vectors, such as the vectors filled by different threads.
+    *
+    * This gives the same matrix as concatenating the vectors in order and
+    * calling stag::sprsMatFromTriplets, without copying the triplets into a
+    * single vector.
+    *
+    * @param triplets the vectors of non-zero entries of the matrix
+    * @param rows the number of rows of the matrix
+    * @param cols the number of columns of the matrix
+    * @return the constructed sparse matrix
+    * @throws std::invalid_argument if any triplet lies outside of the matrix
+    */
+   SprsMat sprsMatFromTriplets(
+       const std::vector<std::vector<EdgeTriplet>>& triplets,
+       StagInt rows, StagInt cols);
+
    /**
     * Add two vectors together element-wise.
     */
@@ -136,6 +172,14 @@ namespace stag {
    */
   std::string getTempFilename();
 
+  /**
+   * Get a temporary filename in the given directory.
+   *
+   * If the directory is an empty string, the system's temporary directory is
+   * used, as for stag::getTempFilename().
+   */
+  std::string getTempFilename(const std::string& directory);
+
   /**
    * Create and open a temporary file.
    *
@@ -0,0 +1,55 @@
+/**
+ * This is a command-line tool for converting an adjacency list file to a
+ * compact adjacency list file.
+ */
+#include <iostream>
+#include <cerrno>
+#include "graphio.h"
+
+
+void print_usage() {
+  std::cout << "Usage: stag_adj2compact [adjacencylist] [compact] [--weights double|float|none]" << std::endl;
+  std::cout << std::endl;
+  std::cout << "Convert a STAG adjacency list file to a compact adjacency list file." << std::endl;
+  std::cout << std::endl;
+  std::cout << "Arguments:" << std::endl;
+  std::cout << "  [adjacencylist]   the name of the adjacencylist file to be converted" << std::endl;
+  std::cout << "  [compact]         the name of the new compact adjacency list file to be written" << std::endl;
+  std::cout << "  --weights         store the weights exactly (double, the default), as" << std::endl;
+  std::cout << "                    single-precision floats (float), or not at all (none)" << std::endl;
+}
+
+
+int main(int argc, char** args) {
+  // This program takes two arguments: the adjacencylist file and the compact
+  // adjacency list file to write to, followed by an optional flag.
+  if (argc != 3 && argc != 5) {
+    print_usage();
+    return EINVAL;
+  }
+
+  // Extract the command line arguments.
+  std::string adj_fname;
+  std::string compact_fname;
+  stag::CompactWeights weights = stag::DoubleWeights;
+  try {
+    adj_fname = std::string(args[1]);
+    compact_fname = std::string(args[2]);
+    if (argc == 5) {
+      std::string flag(args[3]);
+      std::string encoding(args[4]);
+      if (flag != "--weights") throw std::invalid_argument("");
+      if (encoding == "double") weights = stag::DoubleWeights;
+      else if (encoding == "float") weights = stag::FloatWeights;
+      else if (encoding == "none") weights = stag::NoWeights;
+      else throw std::invalid_argument("");
+    }
+  } catch (...) {
+    print_usage();
+    return EINVAL;
+  }
+
+  stag::adjacencylist_to_compact(adj_fname, compact_fname, weights);
+
+  return 0;
+}
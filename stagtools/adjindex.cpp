@@ -0,0 +1,40 @@
+/**
+ * This is a command-line tool for creating the index of an adjacency list
+ * file, which is used by the stag::AdjacencyListLocalGraph object.
+ */
+#include <iostream>
+#include <cerrno>
+#include "graph.h"
+
+
+void print_usage() {
+  std::cout << "Usage: stag_adjindex [adjacencylist]" << std::endl;
+  std::cout << std::endl;
+  std::cout << "Create the index file [adjacencylist].idx for a STAG adjacency list file." << std::endl;
+  std::cout << std::endl;
+  std::cout << "Arguments:" << std::endl;
+  std::cout << "  [adjacencylist]   the name of the adjacencylist file to be indexed" << std::endl;
+}
+
+
+int main(int argc, char** args) {
+  // This program takes one argument: the adjacencylist file to index.
+  if (argc != 2) {
+    print_usage();
+    return EINVAL;
+  }
+
+  // Extract the command line arguments.
+  std::string adj_fname;
+  try {
+    adj_fname = std::string(args[1]);
+  } catch (...) {
+    print_usage();
+    return EINVAL;
+  }
+
+  stag::AdjacencyListLocalGraph graph(adj_fname);
+  graph.save_index();
+
+  return 0;
+}
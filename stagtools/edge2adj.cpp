@@ -4,40 +4,65 @@
  */
 #include <iostream>
 #include <cerrno>
+#include <cctype>
+#include <cstdint>
 #include "graphio.h"
 
 
 void print_usage() {
-  std::cout << "Usage: stag_edge2adj [edgelist] [adjacencylist]" << std::endl;
+  std::cout << "Usage: stag_edge2adj [edgelist] [adjacencylist] [--memory megabytes] [--temp-dir directory]" << std::endl;
   std::cout << std::endl;
   std::cout << "Convert an edgelist file to a STAG adjacency list file." << std::endl;
   std::cout << std::endl;
   std::cout << "Arguments:" << std::endl;
   std::cout << "  [edgelist]        the name of the edgelist file to be converted" << std::endl;
   std::cout << "  [adjacencylist]   the name of the new adjacencylist file to be written" << std::endl;
+  std::cout << "  --memory          the number of megabytes of edges to sort in memory (default 1024)" << std::endl;
+  std::cout << "  --temp-dir        the directory in which to write temporary files" << std::endl;
 }
 
 
 int main(int argc, char** args) {
   // This program takes two arguments: the edgelist file and the adjacencylist
-  // file to write to.
-  if (argc != 3) {
+  // file to write to, followed by optional flags.
+  if (argc < 3 || argc % 2 == 0 || argc > 7) {
     print_usage();
     return EINVAL;
   }
 
-  // Extract the command lien arguments.
+  // Extract the command line arguments.
   std::string adj_fname;
   std::string edge_fname;
+  StagUInt memory_limit = (StagUInt) 1 << 30;
+  std::string temp_directory;
   try {
     edge_fname = std::string(args[1]);
     adj_fname = std::string(args[2]);
+    for (int i = 3; i < argc; i += 2) {
+      std::string flag(args[i]);
+      if (flag == "--memory") {
+        // The number of megabytes must be a positive integer, small enough
+        // that the number of bytes does not overflow.
+        std::string megabytes(args[i + 1]);
+        if (megabytes.empty() || !std::isdigit((unsigned char) megabytes[0])) {
+          throw std::invalid_argument("");
+        }
+        unsigned long long value = std::stoull(megabytes);
+        if (value == 0 || value > (SIZE_MAX >> 20)) throw std::invalid_argument("");
+        memory_limit = (StagUInt) value << 20;
+      } else if (flag == "--temp-dir") {
+        temp_directory = std::string(args[i + 1]);
+      } else {
+        throw std::invalid_argument("");
+      }
+    }
   } catch (...) {
     print_usage();
     return EINVAL;
   }
 
-  stag::edgelist_to_adjacencylist(edge_fname, adj_fname);
+  stag::edgelist_to_adjacencylist(edge_fname, adj_fname, memory_limit,
+                                  temp_directory);
 
   return 0;
 }
@@ -0,0 +1,78 @@
+/**
+ * This is a command-line tool for serving a graph to other processes, which
+ * read it with the stag::RemoteLocalGraph object.
+ */
+#include <iostream>
+#include <cerrno>
+#include <cctype>
+#include <cstdint>
+#include "graph.h"
+#include "graphio.h"
+#include "graphserver.h"
+
+
+void print_usage() {
+  std::cout << "Usage: stag_graphserver [adjacencylist] [socket] [--in-memory] [--cache-budget megabytes]" << std::endl;
+  std::cout << std::endl;
+  std::cout << "Serve a STAG adjacency list file to other processes over a Unix domain socket." << std::endl;
+  std::cout << std::endl;
+  std::cout << "Arguments:" << std::endl;
+  std::cout << "  [adjacencylist]   the name of the adjacencylist file to be served" << std::endl;
+  std::cout << "  [socket]          the path of the socket to listen on" << std::endl;
+  std::cout << "  --in-memory       load the whole graph into memory, rather than reading it from disk" << std::endl;
+  std::cout << "  --cache-budget    the number of megabytes used to cache neighborhoods read from disk (default 1024)" << std::endl;
+}
+
+
+int main(int argc, char** args) {
+  // This program takes two arguments: the adjacencylist file and the socket
+  // to listen on, followed by optional flags.
+  if (argc < 3 || argc > 6) {
+    print_usage();
+    return EINVAL;
+  }
+
+  // Extract the command line arguments.
+  std::string adj_fname;
+  std::string socket_path;
+  bool in_memory = false;
+  StagUInt cache_budget = (StagUInt) 1 << 30;
+  try {
+    adj_fname = std::string(args[1]);
+    socket_path = std::string(args[2]);
+    for (int i = 3; i < argc; i++) {
+      std::string flag(args[i]);
+      if (flag == "--in-memory") {
+        in_memory = true;
+      } else if (flag == "--cache-budget" && i + 1 < argc) {
+        // The number of megabytes must be a non-negative integer, small
+        // enough that the number of bytes does not overflow.
+        std::string megabytes(args[++i]);
+        if (megabytes.empty() || !std::isdigit((unsigned char) megabytes[0])) {
+          throw std::invalid_argument("");
+        }
+        unsigned long long value = std::stoull(megabytes);
+        if (value > (SIZE_MAX >> 20)) throw std::invalid_argument("");
+        cache_budget = (StagUInt) value << 20;
+      } else {
+        throw std::invalid_argument("");
+      }
+    }
+  } catch (...) {
+    print_usage();
+    return EINVAL;
+  }
+
+  if (in_memory) {
+    stag::Graph graph = stag::load_adjacencylist(adj_fname);
+    stag::GraphServer server(&graph, socket_path);
+    server.serve();
+  } else {
+    stag::AdjacencyListLocalGraph graph(adj_fname);
+    graph.set_cache_budget(cache_budget);
+    stag::GraphServer server(&graph, socket_path);
+    server.serve();
+  }
+
+  return 0;
+}